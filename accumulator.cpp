@@ -0,0 +1,114 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "accumulator.h"
+
+#include <stdexcept>
+
+#include "state.h"
+
+
+AdjustmentAccumulator::AdjustmentAccumulator(const std::string& deviceId,
+                                             uint8_t code)
+{
+    auto name = "Local\\ddccli-adjust-" + hashDeviceId(deviceId) + "-"
+                + std::to_string(code);
+
+    // Fresh mappings are zero-filled
+    mapping = CreateFileMappingA(INVALID_HANDLE_VALUE,
+                                 NULL,
+                                 PAGE_READWRITE,
+                                 0,
+                                 sizeof(LONG),
+                                 name.c_str());
+    if (mapping == NULL) {
+        throw std::runtime_error("failed to create adjustment accumulator");
+    }
+
+    delta = static_cast<volatile LONG*>(
+      MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(LONG)));
+    if (delta == NULL) {
+        CloseHandle(mapping);
+        throw std::runtime_error("failed to map adjustment accumulator");
+    }
+
+    applier = CreateMutexA(NULL, FALSE, (name + "-applier").c_str());
+    if (applier == NULL) {
+        UnmapViewOfFile(const_cast<LONG*>(delta));
+        CloseHandle(mapping);
+        throw std::runtime_error("failed to create adjustment applier lock");
+    }
+}
+
+AdjustmentAccumulator::~AdjustmentAccumulator()
+{
+    release();
+    CloseHandle(applier);
+    UnmapViewOfFile(const_cast<LONG*>(delta));
+    CloseHandle(mapping);
+}
+
+void
+AdjustmentAccumulator::add(long delta)
+{
+    InterlockedExchangeAdd(this->delta, static_cast<LONG>(delta));
+}
+
+long
+AdjustmentAccumulator::take()
+{
+    return InterlockedExchange(delta, 0);
+}
+
+long
+AdjustmentAccumulator::pending()
+{
+    return InterlockedCompareExchange(delta, 0, 0);
+}
+
+bool
+AdjustmentAccumulator::tryClaim()
+{
+    if (claimed) {
+        return true;
+    }
+
+    // An abandoned claim (applier crashed) is still acquired; whatever the
+    // applier had taken is lost, the rest is still pending
+    auto result = WaitForSingleObject(applier, 0);
+    claimed = result == WAIT_OBJECT_0 || result == WAIT_ABANDONED;
+
+    return claimed;
+}
+
+void
+AdjustmentAccumulator::release()
+{
+    if (!claimed) {
+        return;
+    }
+
+    ReleaseMutex(applier);
+    claimed = false;
+}
@@ -0,0 +1,78 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+#include "windows.h"
+
+#include <cstdint>
+#include <string>
+
+
+/**
+ * Net relative adjustment pending for one monitor and VCP code, shared
+ * between processes through a named memory mapping.
+ *
+ * Rapid invocations (e.g. brightness keys) each add their delta here. Only
+ * the process that claims the accumulator (the applier) takes the total and
+ * applies it in one write; the others exit straight away, leaving the
+ * applier to drain their delta before it lets go. The claim is separate from
+ * the monitor's BusLock, which may be held for unrelated work.
+ *
+ * Deltas are best effort. The total lives only as long as some process has
+ * the mapping open, so a delta put back after a failed write is dropped if
+ * no other process is adjusting, and a delta taken by an applier that dies
+ * before writing it is lost.
+ */
+class AdjustmentAccumulator {
+public:
+    AdjustmentAccumulator(const std::string& deviceId, uint8_t code);
+    ~AdjustmentAccumulator();
+
+    AdjustmentAccumulator(const AdjustmentAccumulator&) = delete;
+    AdjustmentAccumulator& operator=(const AdjustmentAccumulator&) = delete;
+
+    void add(long delta);
+
+    // Atomically takes the pending total, leaving zero
+    long take();
+
+    long pending();
+
+    /**
+     * Becomes the applier for this monitor and code. Returns immediately;
+     * false if another process (or thread) is applying. The claim is
+     * dropped by release() or on destruction.
+     */
+    bool tryClaim();
+
+    void release();
+
+private:
+    HANDLE mapping;
+    HANDLE applier;
+    volatile LONG* delta;
+
+    bool claimed = false;
+};
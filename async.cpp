@@ -0,0 +1,152 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "async.h"
+
+
+void
+EventLoop::post(std::coroutine_handle<> handle)
+{
+    // Notify under the lock: once the last task is resumed the loop may
+    // return and be destroyed
+    std::lock_guard<std::mutex> lock(mutex);
+    ready.push_back(handle);
+    wake.notify_one();
+}
+
+EventLoop::Detached
+EventLoop::drive(Task<void> task)
+{
+    try {
+        co_await task;
+    } catch (...) {
+        if (!error) {
+            error = std::current_exception();
+        }
+    }
+
+    activeTasks--;
+}
+
+void
+EventLoop::spawn(Task<void> task)
+{
+    activeTasks++;
+    post(drive(std::move(task)).handle);
+}
+
+void
+EventLoop::run()
+{
+    while (activeTasks > 0) {
+        std::coroutine_handle<> next;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+
+            auto hasReady = [this] { return !ready.empty(); };
+            if (timers.empty()) {
+                wake.wait(lock, hasReady);
+            } else {
+                wake.wait_until(lock, timers.top().deadline, hasReady);
+            }
+
+            if (!ready.empty()) {
+                next = ready.front();
+                ready.pop_front();
+            }
+        }
+
+        if (!next && !timers.empty()
+            && timers.top().deadline <= AsyncClock::now()) {
+            next = timers.top().handle;
+            timers.pop();
+        }
+
+        if (next) {
+            next.resume();
+        }
+    }
+
+    if (error) {
+        auto rethrown = error;
+        error = nullptr;
+        std::rethrow_exception(rethrown);
+    }
+}
+
+
+AsyncMonitor::AsyncMonitor(EventLoop& loop,
+                           BusExecutor& executor,
+                           std::string id,
+                           HANDLE handle,
+                           const RetryPolicies& retryPolicies)
+  : loop(loop)
+  , executor(executor)
+  , deviceId(std::move(id))
+  , handle(handle)
+  , busLock(deviceId)
+  , retryPolicies(retryPolicies)
+  , rateController(busRateController(deviceId))
+{}
+
+Task<VcpFeature>
+AsyncMonitor::getVcp(uint8_t code)
+{
+    co_return co_await call<VcpFeature>(
+      [code](HANDLE hMonitor) { return getVcpFeature(hMonitor, code); });
+}
+
+Task<Result<VcpFeature>>
+AsyncMonitor::tryGetVcp(uint8_t code)
+{
+    auto const& policy = retryPolicies.read;
+    auto deadline = AsyncClock::now() + policy.deadline;
+
+    for (unsigned attempt = 1;; attempt++) {
+        auto result = co_await call<Result<VcpFeature>>(
+          [code](HANDLE hMonitor) { return tryGetVcpFeature(hMonitor, code); });
+
+        if (result || attempt >= policy.maxAttempts
+            || !isRetryable(result.error().code)) {
+            co_return result;
+        }
+
+        auto delay = retryBackoff(policy, attempt);
+        if (AsyncClock::now() + delay > deadline) {
+            co_return result;
+        }
+
+        retries++;
+        co_await loop.sleep(delay);
+    }
+}
+
+Task<VcpFeature>
+AsyncMonitor::setVcp(VcpCode code, unsigned long value)
+{
+    co_return co_await call<VcpFeature>([code, value](HANDLE hMonitor) {
+        return setVcpFeature(hMonitor, code, value);
+    });
+}
@@ -0,0 +1,402 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+#include "windows.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "bus_lock.h"
+#include "executor.h"
+#include "monitor.h"
+#include "rate_controller.h"
+#include "retry.h"
+#include "vcp.h"
+
+
+/**
+ * Coroutine-based async DDC API.
+ *
+ * Coroutines run on a single EventLoop thread. Waits (inter-message delays,
+ * backoff, polling) are timers on the loop and hold no thread. The dxva2
+ * calls themselves are blocking and can't be split, so each transaction is
+ * handed to the BusExecutor and the coroutine resumes on the loop when it
+ * completes. One loop thread can drive any number of monitors.
+ */
+
+using AsyncClock = std::chrono::steady_clock;
+
+
+template<typename T>
+class Task;
+
+namespace detail {
+
+// Resumes whoever awaited the finished task
+struct FinalAwaiter {
+    bool await_ready() noexcept { return false; }
+    void await_resume() noexcept {}
+
+    template<typename Promise>
+    std::coroutine_handle<> await_suspend(
+      std::coroutine_handle<Promise> handle) noexcept
+    {
+        auto continuation = handle.promise().continuation;
+        return continuation ? continuation : std::noop_coroutine();
+    }
+};
+
+struct PromiseBase {
+    std::coroutine_handle<> continuation;
+    std::exception_ptr error;
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+
+    void unhandled_exception() { error = std::current_exception(); }
+};
+
+template<typename T>
+struct Promise : PromiseBase {
+    std::optional<T> value;
+
+    Task<T> get_return_object();
+    void return_value(T result) { value = std::move(result); }
+
+    T result()
+    {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        return std::move(*value);
+    }
+};
+
+template<>
+struct Promise<void> : PromiseBase {
+    Task<void> get_return_object();
+    void return_void() {}
+
+    void result()
+    {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+};
+
+} // namespace detail
+
+
+/**
+ * Lazily-started coroutine. Starts when awaited and resumes the awaiter on
+ * completion.
+ */
+template<typename T = void>
+class [[nodiscard]] Task {
+public:
+    using promise_type = detail::Promise<T>;
+
+    explicit Task(std::coroutine_handle<promise_type> handle) : handle(handle)
+    {}
+
+    Task(Task&& other) noexcept : handle(std::exchange(other.handle, {})) {}
+
+    Task& operator=(Task&& other) noexcept
+    {
+        if (this != &other) {
+            if (handle) {
+                handle.destroy();
+            }
+            handle = std::exchange(other.handle, {});
+        }
+        return *this;
+    }
+
+    ~Task()
+    {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter)
+    {
+        handle.promise().continuation = awaiter;
+        return handle;
+    }
+
+    T await_resume() { return handle.promise().result(); }
+
+private:
+    std::coroutine_handle<promise_type> handle;
+};
+
+template<typename T>
+Task<T>
+detail::Promise<T>::get_return_object()
+{
+    return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline Task<void>
+detail::Promise<void>::get_return_object()
+{
+    return Task<void>(
+      std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+
+
+class EventLoop {
+public:
+    /**
+     * Queues a coroutine to be resumed on the loop thread. Thread-safe.
+     */
+    void post(std::coroutine_handle<> handle);
+
+    /**
+     * Starts a task on the loop. run() returns once all spawned tasks are
+     * done.
+     */
+    void spawn(Task<void> task);
+
+    /**
+     * Runs until every spawned task has completed. Rethrows the first
+     * exception that escaped a spawned task.
+     */
+    void run();
+
+    auto sleepUntil(AsyncClock::time_point deadline)
+    {
+        struct TimerAwaiter {
+            EventLoop& loop;
+            AsyncClock::time_point deadline;
+
+            bool await_ready() const { return deadline <= AsyncClock::now(); }
+
+            void await_suspend(std::coroutine_handle<> handle)
+            {
+                loop.timers.push({ deadline, loop.timerSequence++, handle });
+            }
+
+            void await_resume() {}
+        };
+
+        return TimerAwaiter{ *this, deadline };
+    }
+
+    auto sleep(AsyncClock::duration duration)
+    {
+        return sleepUntil(AsyncClock::now() + duration);
+    }
+
+private:
+    struct Timer {
+        AsyncClock::time_point deadline;
+        uint64_t sequence;
+        std::coroutine_handle<> handle;
+
+        bool operator>(const Timer& other) const
+        {
+            return deadline != other.deadline ? deadline > other.deadline
+                                              : sequence > other.sequence;
+        }
+    };
+
+    struct Detached {
+        struct promise_type {
+            Detached get_return_object()
+            {
+                return { std::coroutine_handle<promise_type>::from_promise(
+                  *this) };
+            }
+
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() { std::terminate(); }
+        };
+
+        std::coroutine_handle<promise_type> handle;
+    };
+
+    Detached drive(Task<void> task);
+
+    // Loop thread only
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers;
+    uint64_t timerSequence = 0;
+    size_t activeTasks = 0;
+    std::exception_ptr error;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<std::coroutine_handle<>> ready;
+};
+
+
+namespace detail {
+
+/**
+ * Runs a blocking call on the executor, serialised per bus, and resumes the
+ * awaiting coroutine on the loop with its result.
+ */
+template<typename T>
+class BlockingCall {
+public:
+    BlockingCall(EventLoop& loop,
+                 BusExecutor& executor,
+                 std::string bus,
+                 std::function<T()> call)
+      : loop(loop)
+      , executor(executor)
+      , bus(std::move(bus))
+      , call(std::move(call))
+    {}
+
+    bool await_ready() const { return false; }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        executor.submit(bus, [this, handle] {
+            try {
+                if constexpr (std::is_void_v<T>) {
+                    call();
+                } else {
+                    result = call();
+                }
+            } catch (...) {
+                error = std::current_exception();
+            }
+
+            loop.post(handle);
+        });
+    }
+
+    T await_resume()
+    {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+
+        if constexpr (!std::is_void_v<T>) {
+            return std::move(*result);
+        }
+    }
+
+private:
+    struct Empty {};
+
+    EventLoop& loop;
+    BusExecutor& executor;
+    std::string bus;
+    std::function<T()> call;
+
+    std::conditional_t<std::is_void_v<T>, Empty, std::optional<T>> result;
+    std::exception_ptr error;
+};
+
+} // namespace detail
+
+
+/**
+ * Async view of one physical monitor. Must only be used from the loop thread.
+ */
+class AsyncMonitor {
+public:
+    AsyncMonitor(EventLoop& loop,
+                 BusExecutor& executor,
+                 std::string id,
+                 HANDLE handle,
+                 const RetryPolicies& retryPolicies = defaultRetryPolicies);
+
+    const std::string& id() const { return deviceId; }
+
+    // Total time spent waiting for other processes to release the bus
+    std::chrono::milliseconds lockWaitTime() const { return lockWait; }
+
+    unsigned retryCount() const { return retries; }
+
+    Task<VcpFeature> getVcp(uint8_t code);
+
+    // Retries transient failures, backing off on the loop rather than an
+    // executor thread
+    Task<Result<VcpFeature>> tryGetVcp(uint8_t code);
+    Task<VcpFeature> setVcp(VcpCode code, unsigned long value);
+
+    /**
+     * Runs an arbitrary blocking call against this monitor's handle, with the
+     * same pacing and per-bus serialisation as getVcp/setVcp.
+     */
+    template<typename T>
+    Task<T> call(std::function<T(HANDLE)> fn)
+    {
+        co_await loop.sleepUntil(rateController.nextSlot());
+
+        HANDLE hMonitor = handle;
+        detail::BlockingCall<T> blocking(
+          loop, executor, deviceId, [this, fn = std::move(fn), hMonitor] {
+              ScopedBusLock lock(busLock);
+              lockWait += lock.waited;
+
+              try {
+                  T result = fn(hMonitor);
+                  recordOutcome(rateController, result);
+                  return result;
+              } catch (...) {
+                  rateController.recordFailure(DdcErrorCode::Failed);
+                  throw;
+              }
+          });
+
+        co_return co_await blocking;
+    }
+
+private:
+    EventLoop& loop;
+    BusExecutor& executor;
+    std::string deviceId;
+    HANDLE handle;
+    BusLock busLock;
+    RetryPolicies retryPolicies;
+    BusRateController& rateController;
+
+    std::chrono::milliseconds lockWait{ 0 };
+    unsigned retries = 0;
+};
@@ -0,0 +1,241 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "bus_lock.h"
+
+#include <stdexcept>
+
+#include "state.h"
+
+
+namespace {
+
+// How long the queue may sit idle with the bus free before the ticket being
+// served is presumed dead
+constexpr DWORD staleTicketTimeout = 1000;
+
+constexpr DWORD pollInterval = 1;
+
+LONG
+load(volatile LONG* value)
+{
+    return InterlockedCompareExchange(value, 0, 0);
+}
+
+} // namespace
+
+
+BusLock::BusLock(const std::string& deviceId)
+{
+    auto key = hashDeviceId(deviceId);
+
+    mutex = CreateMutexA(NULL, FALSE, ("Local\\ddccli-bus-" + key).c_str());
+    if (mutex == NULL) {
+        throw std::runtime_error("failed to create bus lock");
+    }
+
+    // Fresh mappings are zero-filled
+    auto ticketsName = "Local\\ddccli-bus-tickets-" + key;
+    mapping = CreateFileMappingA(INVALID_HANDLE_VALUE,
+                                 NULL,
+                                 PAGE_READWRITE,
+                                 0,
+                                 sizeof(Tickets),
+                                 ticketsName.c_str());
+    if (mapping == NULL) {
+        CloseHandle(mutex);
+        throw std::runtime_error("failed to create bus lock queue");
+    }
+
+    tickets = static_cast<Tickets*>(
+      MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(Tickets)));
+    if (tickets == NULL) {
+        CloseHandle(mapping);
+        CloseHandle(mutex);
+        throw std::runtime_error("failed to map bus lock queue");
+    }
+}
+
+BusLock::~BusLock()
+{
+    release();
+    UnmapViewOfFile(tickets);
+    CloseHandle(mapping);
+    CloseHandle(mutex);
+}
+
+std::chrono::milliseconds
+BusLock::acquire()
+{
+    if (held) {
+        return std::chrono::milliseconds(0);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    ticket = InterlockedIncrement(&tickets->next) - 1;
+    InterlockedExchange(&tickets->progressTick, GetTickCount());
+
+    for (;;) {
+        LONG serving = load(&tickets->serving);
+
+        // Past our ticket only if we were skipped as stale; go anyway, the
+        // mutex still guarantees exclusion
+        if (serving - ticket >= 0) {
+            break;
+        }
+
+        skipStaleTicket(serving);
+        Sleep(pollInterval);
+    }
+
+    lockMutex(INFINITE);
+    held = true;
+
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start);
+}
+
+bool
+BusLock::tryAcquire()
+{
+    if (held) {
+        return true;
+    }
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        LONG serving = load(&tickets->serving);
+
+        // Only take a ticket if nobody holds or waits for the bus
+        if (InterlockedCompareExchange(&tickets->next, serving + 1, serving)
+            == serving) {
+            ticket = serving;
+            InterlockedExchange(&tickets->progressTick, GetTickCount());
+
+            if (lockMutex(0)) {
+                held = true;
+                return true;
+            }
+
+            advance(ticket);
+            return false;
+        }
+
+        if (!skipStaleTicket(serving)) {
+            return false;
+        }
+    }
+
+    return false;
+}
+
+void
+BusLock::release()
+{
+    if (!held) {
+        return;
+    }
+
+    ReleaseMutex(mutex);
+    advance(ticket);
+    held = false;
+}
+
+bool
+BusLock::lockMutex(DWORD timeout)
+{
+    // An abandoned mutex (holder crashed) is still acquired
+    auto result = WaitForSingleObject(mutex, timeout);
+    return result == WAIT_OBJECT_0 || result == WAIT_ABANDONED;
+}
+
+void
+BusLock::advance(LONG from)
+{
+    if (InterlockedCompareExchange(&tickets->serving, from + 1, from) == from) {
+        InterlockedExchange(&tickets->progressTick, GetTickCount());
+    }
+}
+
+bool
+BusLock::skipStaleTicket(LONG serving)
+{
+    auto lastProgress = static_cast<DWORD>(load(&tickets->progressTick));
+    DWORD idle = GetTickCount() - lastProgress;
+    if (idle < staleTicketTimeout) {
+        return false;
+    }
+
+    // A live owner would be holding the mutex or grabbing it within a poll
+    if (!lockMutex(0)) {
+        return false;
+    }
+
+    advance(serving);
+    ReleaseMutex(mutex);
+
+    return true;
+}
+
+
+BusActivity::BusActivity(const std::string& deviceId)
+{
+    auto name = "Local\\ddccli-bus-activity-" + hashDeviceId(deviceId);
+
+    mutex = CreateMutexA(NULL, FALSE, name.c_str());
+    if (mutex == NULL) {
+        throw std::runtime_error("failed to create bus activity marker");
+    }
+}
+
+BusActivity::~BusActivity()
+{
+    release();
+    CloseHandle(mutex);
+}
+
+bool
+BusActivity::acquire(DWORD timeout)
+{
+    if (held) {
+        return true;
+    }
+
+    // Abandoned means the call's process died, taking the call with it
+    auto result = WaitForSingleObject(mutex, timeout);
+    held = result == WAIT_OBJECT_0 || result == WAIT_ABANDONED;
+
+    return held;
+}
+
+void
+BusActivity::release()
+{
+    if (!held) {
+        return;
+    }
+
+    ReleaseMutex(mutex);
+    held = false;
+}
@@ -0,0 +1,128 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+#include "windows.h"
+
+#include <chrono>
+#include <string>
+
+
+/**
+ * Cross-process advisory lock on one monitor's bus, so overlapping ddccli
+ * runs don't interleave DDC/CI messages on the same monitor.
+ *
+ * Mutual exclusion comes from a named mutex derived from the DeviceID. Win32
+ * doesn't guarantee FIFO wakeup for mutex waiters, so waiters also take a
+ * ticket from a shared-memory counter and only contend for the mutex once
+ * their ticket is being served. Tickets whose owner died (while queued or
+ * while holding the bus) are skipped after a short timeout.
+ *
+ * Like any Win32 mutex the lock is owned by the acquiring thread and must be
+ * released there.
+ */
+class BusLock {
+public:
+    explicit BusLock(const std::string& deviceId);
+    ~BusLock();
+
+    BusLock(const BusLock&) = delete;
+    BusLock& operator=(const BusLock&) = delete;
+
+    /**
+     * Blocks until the bus is ours, in FIFO order with other waiters.
+     * Returns the time spent waiting.
+     */
+    std::chrono::milliseconds acquire();
+
+    // Returns immediately; false if the bus is held or others are queued
+    bool tryAcquire();
+
+    void release();
+
+private:
+    struct Tickets {
+        volatile LONG next;
+        volatile LONG serving;
+        volatile LONG progressTick;
+    };
+
+    bool lockMutex(DWORD timeout);
+    void advance(LONG from);
+    bool skipStaleTicket(LONG serving);
+
+    HANDLE mutex;
+    HANDLE mapping;
+    Tickets* tickets;
+
+    bool held = false;
+    LONG ticket = 0;
+};
+
+
+// Holds a BusLock for the enclosing scope
+class ScopedBusLock {
+public:
+    explicit ScopedBusLock(BusLock& lock)
+      : lock(lock)
+      , waited(lock.acquire())
+    {}
+    ~ScopedBusLock() { lock.release(); }
+
+    ScopedBusLock(const ScopedBusLock&) = delete;
+    ScopedBusLock& operator=(const ScopedBusLock&) = delete;
+
+    BusLock& lock;
+    const std::chrono::milliseconds waited;
+};
+
+
+/**
+ * Marks one DDC/CI call in progress on a monitor's bus, across processes.
+ *
+ * BusLock spans a whole transaction, but a call abandoned after a timeout
+ * keeps running on its own thread once its transaction has released the
+ * bus. Every call holds this while it talks to the monitor, so the next
+ * transaction's calls wait for the abandoned one rather than talking over
+ * it. Like BusLock it is owned by the acquiring thread, and it is freed if
+ * that thread's process dies.
+ */
+class BusActivity {
+public:
+    explicit BusActivity(const std::string& deviceId);
+    ~BusActivity();
+
+    BusActivity(const BusActivity&) = delete;
+    BusActivity& operator=(const BusActivity&) = delete;
+
+    // Waits for other calls on the bus to finish; false on timeout
+    bool acquire(DWORD timeout = INFINITE);
+
+    void release();
+
+private:
+    HANDLE mutex;
+    bool held = false;
+};
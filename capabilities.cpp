@@ -0,0 +1,220 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "capabilities.h"
+
+#include <stdexcept>
+
+
+namespace {
+
+int
+hexDigit(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+
+    return -1;
+}
+
+bool
+isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\0';
+}
+
+/**
+ * Returns the index of the parenthesis closing the group opened at `open`.
+ */
+size_t
+findClosingParen(std::string_view str, size_t open)
+{
+    int depth = 0;
+    for (size_t i = open; i < str.size(); i++) {
+        if (str[i] == '(') {
+            depth++;
+        } else if (str[i] == ')' && --depth == 0) {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("unbalanced capabilities string");
+}
+
+/**
+ * Tokenises a vcp(...) list: hex codes, each optionally followed by a
+ * parenthesised list of allowed values. Nested groups within a value list
+ * are flattened.
+ */
+void
+parseVcpList(std::string_view list, MonitorCapabilities& capabilities)
+{
+    int depth = 0;
+    int code = -1;
+
+    for (size_t i = 0; i < list.size(); i++) {
+        char c = list[i];
+
+        if (isSpace(c)) {
+            continue;
+        }
+
+        if (c == '(') {
+            if (depth == 0 && code < 0) {
+                throw std::runtime_error("value list without vcp code");
+            }
+            depth++;
+            continue;
+        }
+
+        if (c == ')') {
+            if (--depth < 0) {
+                throw std::runtime_error("unbalanced capabilities string");
+            }
+            continue;
+        }
+
+        if (i + 1 >= list.size() || hexDigit(c) < 0
+            || hexDigit(list[i + 1]) < 0) {
+            throw std::runtime_error("malformed vcp code in capabilities");
+        }
+
+        auto byte =
+          static_cast<uint8_t>(hexDigit(c) << 4 | hexDigit(list[++i]));
+
+        if (depth == 0) {
+            code = byte;
+            capabilities.vcpCodes.set(byte);
+            capabilities.valueOffsets[byte] =
+              static_cast<uint16_t>(capabilities.values.size());
+            capabilities.valueCounts[byte] = 0;
+        } else if (capabilities.valueCounts[code] < UINT8_MAX) {
+            capabilities.values.push_back(byte);
+            capabilities.valueCounts[code]++;
+        }
+    }
+
+    if (depth != 0) {
+        throw std::runtime_error("unbalanced capabilities string");
+    }
+}
+
+} // namespace
+
+
+MonitorCapabilities
+parseCapabilities(std::string raw)
+{
+    MonitorCapabilities capabilities;
+    capabilities.raw = std::move(raw);
+
+    std::string_view str = capabilities.raw;
+
+    // Every value takes at least two characters, so this is the only
+    // allocation made while parsing.
+    capabilities.values.reserve(str.size() / 2);
+
+    // Strip trailing NULs and the outer parentheses, which some monitors omit
+    size_t begin = 0;
+    size_t end = str.size();
+    while (end > 0 && isSpace(str[end - 1])) {
+        end--;
+    }
+    if (end - begin >= 2 && str[begin] == '(' && str[end - 1] == ')') {
+        begin++;
+        end--;
+    }
+
+    auto field = [](size_t offset, size_t length) {
+        return MonitorCapabilities::Field{ static_cast<uint32_t>(offset),
+                                           static_cast<uint32_t>(length) };
+    };
+
+    size_t i = begin;
+    while (i < end) {
+        size_t open = str.find('(', i);
+        if (open == std::string_view::npos || open >= end) {
+            break;
+        }
+
+        size_t close = findClosingParen(str.substr(0, end), open);
+
+        while (i < open && isSpace(str[i])) {
+            i++;
+        }
+
+        auto key = str.substr(i, open - i);
+        auto value = field(open + 1, close - open - 1);
+
+        if (key == "prot") {
+            capabilities.protocol = value;
+        } else if (key == "type") {
+            capabilities.type = value;
+        } else if (key == "model") {
+            capabilities.model = value;
+        } else if (key == "mccs_ver") {
+            capabilities.mccsVersion = value;
+        } else if (key == "vcp") {
+            parseVcpList(capabilities.get(value), capabilities);
+        }
+
+        i = close + 1;
+    }
+
+    return capabilities;
+}
+
+void
+to_json(nlohmann::json& j, const MonitorCapabilities& capabilities)
+{
+    j = nlohmann::json{
+        { "raw", capabilities.raw },
+        { "protocol", std::string(capabilities.get(capabilities.protocol)) },
+        { "type", std::string(capabilities.get(capabilities.type)) },
+        { "model", std::string(capabilities.get(capabilities.model)) },
+        { "mccsVersion",
+          std::string(capabilities.get(capabilities.mccsVersion)) }
+    };
+
+    static const char digits[] = "0123456789ABCDEF";
+
+    auto& vcp = j["vcp"] = nlohmann::json::object();
+    for (int code = 0; code < 256; code++) {
+        if (!capabilities.vcpCodes.test(code)) {
+            continue;
+        }
+
+        const char key[] = { digits[code >> 4], digits[code & 0xf], '\0' };
+
+        auto allowed = capabilities.allowedValues(static_cast<uint8_t>(code));
+        vcp[key] = std::vector<uint8_t>(allowed.begin(), allowed.end());
+    }
+}
@@ -0,0 +1,97 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <json.hpp>
+
+
+/**
+ * Parsed MCCS capabilities string, e.g.
+ * (prot(monitor)type(lcd)model(U2415)vcp(02 04 10 12 60(0F 11))mccs_ver(2.1))
+ *
+ * Parsing is done in place over `raw`. Text fields are stored as byte ranges
+ * into it rather than as views, so the struct stays valid when copied or
+ * moved, and the VCP table is a fixed-size index over one flat value array.
+ */
+struct MonitorCapabilities {
+    struct Field {
+        uint32_t offset = 0;
+        uint32_t length = 0;
+    };
+
+    struct AllowedValues {
+        const uint8_t* first;
+        const uint8_t* last;
+
+        const uint8_t* begin() const { return first; }
+        const uint8_t* end() const { return last; }
+        size_t size() const { return last - first; }
+        bool empty() const { return first == last; }
+    };
+
+    std::string raw;
+
+    Field protocol;
+    Field type;
+    Field model;
+    Field mccsVersion;
+
+    std::bitset<256> vcpCodes;
+
+    // Allowed values for code c are values[valueOffsets[c]..+valueCounts[c]]
+    std::array<uint16_t, 256> valueOffsets{};
+    std::array<uint8_t, 256> valueCounts{};
+    std::vector<uint8_t> values;
+
+    std::string_view get(Field field) const
+    {
+        return std::string_view(raw).substr(field.offset, field.length);
+    }
+
+    bool supports(uint8_t code) const { return vcpCodes.test(code); }
+
+    /**
+     * Values listed for a non-continuous code. Empty if the monitor doesn't
+     * restrict the code's values.
+     */
+    AllowedValues allowedValues(uint8_t code) const
+    {
+        const uint8_t* first = values.data() + valueOffsets[code];
+        return { first, first + valueCounts[code] };
+    }
+};
+
+MonitorCapabilities
+parseCapabilities(std::string raw);
+
+void
+to_json(nlohmann::json& j, const MonitorCapabilities& capabilities);
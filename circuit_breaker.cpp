@@ -0,0 +1,185 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "circuit_breaker.h"
+
+#include "state.h"
+
+using json = nlohmann::json;
+
+
+namespace {
+
+std::filesystem::path
+getBreakerPath()
+{
+    return getStateDirectory() / "breakers.json";
+}
+
+json
+readEntries()
+{
+    auto contents = readStateFile(getBreakerPath());
+    if (!contents) {
+        return json::object();
+    }
+
+    try {
+        auto entries = json::parse(*contents);
+        if (entries.is_object()) {
+            return entries;
+        }
+    } catch (const std::exception&) {
+        // Corrupt state, start over
+    }
+
+    return json::object();
+}
+
+int64_t
+now()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+} // namespace
+
+
+CircuitBreaker::CircuitBreaker() : entries(readEntries()) {}
+
+BreakerState
+CircuitBreaker::state(const std::string& deviceId) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto opened = openedAt(hashDeviceId(deviceId));
+    if (opened == 0) {
+        return BreakerState::Closed;
+    }
+
+    return now() - opened < cooldown.count() ? BreakerState::Open
+                                             : BreakerState::HalfOpen;
+}
+
+std::chrono::milliseconds
+CircuitBreaker::cooldownRemaining(const std::string& deviceId) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto opened = openedAt(hashDeviceId(deviceId));
+    if (opened == 0) {
+        return std::chrono::milliseconds(0);
+    }
+
+    auto remaining = opened + cooldown.count() - now();
+    return std::chrono::milliseconds(remaining > 0 ? remaining : 0);
+}
+
+void
+CircuitBreaker::recordSuccess(const std::string& deviceId)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto key = hashDeviceId(deviceId);
+    auto entry = entries.find(key);
+    if (entry == entries.end() || entry->value("failures", 0u) == 0) {
+        return;
+    }
+
+    *entry = { { "failures", 0 }, { "openedAt", 0 }, { "time", now() } };
+    changed[key] = *entry;
+}
+
+void
+CircuitBreaker::recordFailure(const std::string& deviceId)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto key = hashDeviceId(deviceId);
+    auto& entry = entries[key];
+    if (!entry.is_object()) {
+        entry = json::object();
+    }
+
+    auto failures = entry.value("failures", 0u) + 1;
+    auto opened = entry.value("openedAt", int64_t(0));
+
+    // A failed probe, or reaching the threshold, (re)starts the cooldown
+    if (failures >= failureThreshold) {
+        opened = now();
+    }
+
+    entry = { { "failures", failures },
+              { "openedAt", opened },
+              { "time", now() } };
+    changed[key] = entry;
+}
+
+void
+CircuitBreaker::save()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (changed.empty()) {
+        return;
+    }
+
+    // Held until the merged file is in place, or another process could
+    // merge against the file this one is about to replace
+    ScopedStateLock fileLock(getBreakerPath());
+
+    auto merged = readEntries();
+    for (auto entry = changed.begin(); entry != changed.end(); ++entry) {
+        auto existing = merged.find(entry.key());
+        if (existing == merged.end() || !existing->is_object()
+            || existing->value("time", int64_t(0))
+                 <= entry->value("time", int64_t(0))) {
+            merged[entry.key()] = *entry;
+        }
+    }
+
+    writeStateFile(getBreakerPath(), merged.dump());
+    entries = std::move(merged);
+    changed = json::object();
+}
+
+int64_t
+CircuitBreaker::openedAt(const std::string& key) const
+{
+    auto entry = entries.find(key);
+    if (entry == entries.end() || !entry->is_object()) {
+        return 0;
+    }
+
+    return entry->value("openedAt", int64_t(0));
+}
+
+bool
+indicatesUnresponsive(DdcErrorCode code)
+{
+    return code != DdcErrorCode::Unsupported
+           && code != DdcErrorCode::OutOfRange;
+}
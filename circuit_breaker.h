@@ -0,0 +1,88 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include <json.hpp>
+
+#include "result.h"
+
+
+enum class BreakerState {
+    Closed,
+    // Quarantined, cooldown still running
+    Open,
+    // Cooldown expired; the next operation is a probe
+    HalfOpen
+};
+
+/**
+ * Per-monitor circuit breaker, persisted in the state directory so a monitor
+ * with broken DDC/CI doesn't cost every invocation a full timeout. After
+ * `failureThreshold` consecutive failed operations the monitor is
+ * quarantined for `cooldown`; after that a single success closes the
+ * breaker again and a failure restarts the cooldown.
+ *
+ * Safe to use from executor threads.
+ */
+class CircuitBreaker {
+public:
+    static constexpr unsigned failureThreshold = 3;
+    static constexpr std::chrono::milliseconds cooldown{ 120000 };
+
+    // Loads breaker state from disk
+    CircuitBreaker();
+
+    BreakerState state(const std::string& deviceId) const;
+
+    // Time left until a quarantined monitor may be probed
+    std::chrono::milliseconds cooldownRemaining(
+      const std::string& deviceId) const;
+
+    void recordSuccess(const std::string& deviceId);
+    void recordFailure(const std::string& deviceId);
+
+    /**
+     * Writes changes back, merged with whatever other processes have stored
+     * since this one loaded (newest entry wins).
+     */
+    void save();
+
+private:
+    int64_t openedAt(const std::string& key) const;
+
+    mutable std::mutex mutex;
+    nlohmann::json entries;
+    nlohmann::json changed = nlohmann::json::object();
+};
+
+// Whether an error means the monitor isn't answering, as opposed to
+// answering with a refusal (unsupported, out of range)
+bool
+indicatesUnresponsive(DdcErrorCode code);
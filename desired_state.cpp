@@ -0,0 +1,195 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "desired_state.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+
+#include "monitor.h"
+
+using json = nlohmann::json;
+
+
+namespace {
+
+unsigned long
+parseDesiredValue(const VcpCode& code, const json& value)
+{
+    if (value.is_number_unsigned()) {
+        auto number = value.get<unsigned long>();
+        if (number <= 0xffff) {
+            return number;
+        }
+    } else if (value.is_string()) {
+        return parseVcpValue(code, value.get<std::string>());
+    }
+
+    throw std::runtime_error("invalid vcp value: " + value.dump());
+}
+
+bool
+isPrefixSelector(const std::string& selector)
+{
+    return !selector.empty() && selector.back() == '*';
+}
+
+} // namespace
+
+
+DesiredState::DesiredState(const json& document)
+{
+    if (!document.is_object()) {
+        throw std::runtime_error(
+          "desired state must map monitor selectors to features");
+    }
+
+    for (auto it = document.begin(); it != document.end(); ++it) {
+        auto const& selector = it.key();
+        auto const& features = *it;
+
+        if (selector.empty() || !features.is_object()) {
+            throw std::runtime_error("invalid selector: " + selector);
+        }
+
+        for (auto feature = features.begin(); feature != features.end();
+             ++feature) {
+            auto code = parseVcpCode(feature.key());
+            if (!code.isWritable()) {
+                throw std::runtime_error("vcp feature is read-only: "
+                                         + feature.key());
+            }
+
+            // Reapplying a state mustn't reset or power cycle the monitor
+            if (!code.isSetting()) {
+                throw std::runtime_error("vcp feature is not a setting: "
+                                         + feature.key());
+            }
+
+            add(selector,
+                { code,
+                  parseDesiredValue(code, *feature),
+                  code.name.empty() ? feature.key() : std::string(code.name) });
+        }
+    }
+}
+
+void
+DesiredState::add(const std::string& selector, const DesiredValue& value)
+{
+    // Kept in code order, one value per code, so a feature given twice (by
+    // name and by code) keeps the last
+    auto& values = selectors[selector];
+    auto it = std::find_if(values.begin(), values.end(), [&](auto& existing) {
+        return existing.code.code >= value.code.code;
+    });
+
+    if (it != values.end() && it->code.code == value.code.code) {
+        *it = value;
+    } else {
+        values.insert(it, value);
+    }
+}
+
+std::vector<DesiredValue>
+DesiredState::valuesFor(const std::string& id) const
+{
+    // Matching selectors from least to most specific; later ones override
+    std::vector<const std::string*> matches;
+    for (auto const& [ selector, values ] : selectors) {
+        if (isPrefixSelector(selector)) {
+            auto prefix = std::string_view(selector).substr(
+              0, selector.size() - 1);
+            if (std::string_view(id).substr(0, prefix.size()) == prefix) {
+                matches.push_back(&selector);
+            }
+        }
+    }
+
+    std::sort(matches.begin(),
+              matches.end(),
+              [](const std::string* a, const std::string* b) {
+                  return a->size() < b->size();
+              });
+
+    if (selectors.count(id)) {
+        matches.push_back(&selectors.find(id)->first);
+    }
+
+    std::map<uint8_t, DesiredValue> merged;
+    for (auto selector : matches) {
+        for (auto const& value : selectors.at(*selector)) {
+            merged[value.code.code] = value;
+        }
+    }
+
+    std::vector<DesiredValue> values;
+    for (auto const& [ code, value ] : merged) {
+        values.push_back(value);
+    }
+
+    return values;
+}
+
+json
+loadJsonDocument(const std::string& path)
+{
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("can't open " + path);
+    }
+
+    std::stringstream contents;
+    contents << file.rdbuf();
+
+    try {
+        return json::parse(contents.str());
+    } catch (const std::exception& e) {
+        throw std::runtime_error(path + ": " + e.what());
+    }
+}
+
+std::map<std::string, DesiredState>
+loadPresets(const std::string& path)
+{
+    auto document = loadJsonDocument(path);
+    if (!document.is_object()) {
+        throw std::runtime_error(path + ": expected an object of presets");
+    }
+
+    std::map<std::string, DesiredState> presets;
+    for (auto it = document.begin(); it != document.end(); ++it) {
+        try {
+            presets.emplace(it.key(), DesiredState(*it));
+        } catch (const std::runtime_error& e) {
+            throw std::runtime_error(path + ": preset " + it.key() + ": "
+                                     + e.what());
+        }
+    }
+
+    return presets;
+}
@@ -0,0 +1,90 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <json.hpp>
+
+#include "vcp.h"
+
+
+struct DesiredValue {
+    VcpCode code;
+    unsigned long value;
+
+    // Name used in results: the MCCS name, or the code as written
+    std::string feature;
+};
+
+/**
+ * A validated desired-state document: VCP values to converge to, keyed by
+ * monitor selector.
+ *
+ * The document maps selectors to objects of feature/value pairs, features
+ * and values given as for --set-vcp:
+ *
+ *     { "*": { "brightness": 40 }, "<id>": { "input": "hdmi1" } }
+ *
+ * A selector is either a monitor id or a prefix ending in "*" ("*" alone
+ * matches every monitor). Where several match, the most specific wins for
+ * each feature: exact ids over prefixes, longer prefixes over shorter ones.
+ */
+class DesiredState {
+public:
+    /**
+     * Validates the whole document up front. Throws runtime_error naming
+     * the first invalid selector, feature or value.
+     */
+    explicit DesiredState(const nlohmann::json& document);
+
+    DesiredState() = default;
+
+    // Sets one value for `selector`, replacing any earlier one for the code
+    void add(const std::string& selector, const DesiredValue& value);
+
+    // Values that apply to `id`, in VCP code order
+    std::vector<DesiredValue> valuesFor(const std::string& id) const;
+
+private:
+    std::map<std::string, std::vector<DesiredValue>> selectors;
+};
+
+/**
+ * Loads a preset file: an object mapping preset names ("day", "night") to
+ * desired-state documents. Every preset is validated, so a mistake in one
+ * is reported whichever is used.
+ */
+std::map<std::string, DesiredState>
+loadPresets(const std::string& path);
+
+/**
+ * Reads and parses a JSON document from `path`, throwing runtime_error if it
+ * can't be read or isn't valid JSON.
+ */
+nlohmann::json
+loadJsonDocument(const std::string& path);
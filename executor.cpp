@@ -0,0 +1,201 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "executor.h"
+
+#include <algorithm>
+
+
+BusExecutor::BusExecutor(size_t threadCount)
+{
+    threadCount = (std::max)(threadCount, size_t(1));
+
+    for (size_t i = 0; i < threadCount; i++) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+
+    for (size_t i = 0; i < threadCount; i++) {
+        threads.emplace_back(&BusExecutor::run, this, i);
+    }
+}
+
+BusExecutor::~BusExecutor()
+{
+    {
+        std::lock_guard<std::mutex> lock(idleMutex);
+        stopping = true;
+    }
+    idle.notify_all();
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+void
+BusExecutor::submit(const std::string& busId, std::function<void()> job)
+{
+    Bus* bus;
+    size_t worker;
+    {
+        std::lock_guard<std::mutex> lock(busesMutex);
+
+        auto& entry = buses[busId];
+        if (!entry) {
+            entry = std::make_unique<Bus>();
+        }
+
+        bus = entry.get();
+        worker = nextWorker++ % workers.size();
+    }
+
+    pendingJobs++;
+
+    bool needsScheduling;
+    {
+        std::lock_guard<std::mutex> lock(bus->mutex);
+        bus->jobs.push_back(std::move(job));
+        needsScheduling = !bus->scheduled;
+        bus->scheduled = true;
+    }
+
+    if (needsScheduling) {
+        schedule(bus, worker);
+    }
+}
+
+void
+BusExecutor::wait()
+{
+    std::unique_lock<std::mutex> lock(idleMutex);
+    done.wait(lock, [this] { return pendingJobs == 0; });
+
+    if (error) {
+        auto rethrown = error;
+        error = nullptr;
+        std::rethrow_exception(rethrown);
+    }
+}
+
+void
+BusExecutor::schedule(Bus* bus, size_t worker)
+{
+    {
+        std::lock_guard<std::mutex> lock(workers[worker]->mutex);
+        workers[worker]->runnable.push_back(bus);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(idleMutex);
+        runnableCount++;
+    }
+    idle.notify_one();
+}
+
+BusExecutor::Bus*
+BusExecutor::take(size_t index)
+{
+    // Own deque first, newest first
+    {
+        auto& own = *workers[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.runnable.empty()) {
+            auto bus = own.runnable.back();
+            own.runnable.pop_back();
+            runnableCount--;
+            return bus;
+        }
+    }
+
+    // Steal the oldest entry from another thread
+    for (size_t i = 1; i < workers.size(); i++) {
+        auto& victim = *workers[(index + i) % workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.runnable.empty()) {
+            auto bus = victim.runnable.front();
+            victim.runnable.pop_front();
+            runnableCount--;
+            return bus;
+        }
+    }
+
+    return nullptr;
+}
+
+void
+BusExecutor::run(size_t index)
+{
+    for (;;) {
+        Bus* bus = take(index);
+
+        if (!bus) {
+            std::unique_lock<std::mutex> lock(idleMutex);
+            idle.wait(lock, [this] { return stopping || runnableCount > 0; });
+
+            if (stopping && runnableCount == 0) {
+                return;
+            }
+            continue;
+        }
+
+        std::function<void()> job;
+        {
+            std::lock_guard<std::mutex> lock(bus->mutex);
+            job = std::move(bus->jobs.front());
+            bus->jobs.pop_front();
+        }
+
+        try {
+            job();
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(idleMutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+
+        // Requeue the bus locally if it has more work; others may steal it
+        bool hasMore;
+        {
+            std::lock_guard<std::mutex> lock(bus->mutex);
+            hasMore = !bus->jobs.empty();
+            bus->scheduled = hasMore;
+        }
+
+        if (hasMore) {
+            schedule(bus, index);
+        }
+
+        if (--pendingJobs == 0) {
+            std::lock_guard<std::mutex> lock(idleMutex);
+            done.notify_all();
+        }
+    }
+}
+
+size_t
+defaultExecutorThreads(size_t busCount)
+{
+    return (std::min)(busCount, size_t(16));
+}
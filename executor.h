@@ -0,0 +1,122 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+/**
+ * Work-stealing pool for bulk per-monitor operations.
+ *
+ * Jobs are queued per bus: a bus only ever has one job running, and its jobs
+ * run in submission order. Runnable buses sit in per-thread deques; a thread
+ * pops from the back of its own deque and, when that is empty, steals from
+ * the front of another's, so threads stuck behind a slow bus don't leave
+ * fast buses waiting.
+ */
+class BusExecutor {
+public:
+    explicit BusExecutor(size_t threadCount);
+    ~BusExecutor();
+
+    BusExecutor(const BusExecutor&) = delete;
+    BusExecutor& operator=(const BusExecutor&) = delete;
+
+    void submit(const std::string& bus, std::function<void()> job);
+
+    /**
+     * Blocks until every submitted job has finished. Rethrows the first
+     * exception thrown by a job, if any.
+     */
+    void wait();
+
+private:
+    struct Bus {
+        std::mutex mutex;
+        std::deque<std::function<void()>> jobs;
+        bool scheduled = false;
+    };
+
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Bus*> runnable;
+    };
+
+    void run(size_t index);
+    void schedule(Bus* bus, size_t worker);
+    Bus* take(size_t index);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+
+    std::mutex busesMutex;
+    std::map<std::string, std::unique_ptr<Bus>> buses;
+    size_t nextWorker = 0;
+
+    // Idle threads and wait() park here; never taken on the fast path
+    std::mutex idleMutex;
+    std::condition_variable idle;
+    std::condition_variable done;
+    std::atomic<size_t> runnableCount{ 0 };
+    std::atomic<size_t> pendingJobs{ 0 };
+    bool stopping = false;
+
+    std::exception_ptr error;
+};
+
+
+/**
+ * Number of threads to use for `busCount` buses. DDC transactions spend most
+ * of their time waiting on the monitor, so this isn't tied to core count.
+ */
+size_t
+defaultExecutorThreads(size_t busCount);
+
+/**
+ * Runs `fn(id, handle)` for every entry of `monitors` on `executor`, one job
+ * per bus, and waits for all of them.
+ */
+template<typename Monitors, typename Fn>
+void
+forEachMonitor(BusExecutor& executor, const Monitors& monitors, Fn fn)
+{
+    for (auto const& [ id, handle ] : monitors) {
+        executor.submit(id,
+                        [&fn, &id = id, handle = handle] { fn(id, handle); });
+    }
+
+    executor.wait();
+}
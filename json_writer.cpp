@@ -0,0 +1,223 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "json_writer.h"
+
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+
+JsonWriter::JsonWriter(std::ostream& out) : out(out) {}
+
+JsonWriter&
+JsonWriter::beginObject()
+{
+    separate();
+    out.put('{');
+    scopes.push_back({ true, true });
+    return *this;
+}
+
+JsonWriter&
+JsonWriter::endObject()
+{
+    scopes.pop_back();
+    out.put('}');
+    return *this;
+}
+
+JsonWriter&
+JsonWriter::beginArray()
+{
+    separate();
+    out.put('[');
+    scopes.push_back({ false, true });
+    return *this;
+}
+
+JsonWriter&
+JsonWriter::endArray()
+{
+    scopes.pop_back();
+    out.put(']');
+    return *this;
+}
+
+JsonWriter&
+JsonWriter::key(std::string_view name)
+{
+    separate();
+    writeString(name);
+    out.put(':');
+    afterKey = true;
+    return *this;
+}
+
+JsonWriter&
+JsonWriter::value(std::string_view string)
+{
+    separate();
+    writeString(string);
+    return *this;
+}
+
+JsonWriter&
+JsonWriter::value(bool boolean)
+{
+    separate();
+    out << (boolean ? "true" : "false");
+    return *this;
+}
+
+JsonWriter&
+JsonWriter::value(const nlohmann::json& fragment)
+{
+    separate();
+    out << fragment;
+    return *this;
+}
+
+void
+JsonWriter::close()
+{
+    while (!scopes.empty()) {
+        if (scopes.back().isObject) {
+            endObject();
+        } else {
+            endArray();
+        }
+    }
+}
+
+void
+JsonWriter::separate()
+{
+    // A value directly after its key needs no comma
+    if (afterKey) {
+        afterKey = false;
+        return;
+    }
+
+    if (scopes.empty()) {
+        return;
+    }
+
+    if (!scopes.back().isEmpty) {
+        out.put(',');
+    }
+    scopes.back().isEmpty = false;
+}
+
+void
+JsonWriter::writeString(std::string_view string)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    out.put('"');
+
+    for (char c : string) {
+        switch (c) {
+            case '\b':
+                out << "\\b";
+                break;
+            case '\t':
+                out << "\\t";
+                break;
+            case '\n':
+                out << "\\n";
+                break;
+            case '\f':
+                out << "\\f";
+                break;
+            case '\r':
+                out << "\\r";
+                break;
+            case '"':
+                out << "\\\"";
+                break;
+            case '\\':
+                out << "\\\\";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) <= 0x1f) {
+                    out << "\\u00" << hex[(c >> 4) & 0xf] << hex[c & 0xf];
+                } else {
+                    out.put(c);
+                }
+        }
+    }
+
+    out.put('"');
+}
+
+OrderedMembers::OrderedMembers(JsonWriter& writer,
+                               std::vector<std::string> keys)
+  : writer(writer)
+{
+    members.reserve(keys.size());
+    for (auto& key : keys) {
+        members.push_back({ std::move(key), std::nullopt, false });
+    }
+}
+
+void
+OrderedMembers::write(std::string_view key, nlohmann::json value)
+{
+    auto& member = find(key);
+    member.value = std::move(value);
+    member.settled = true;
+    release();
+}
+
+void
+OrderedMembers::drop(std::string_view key)
+{
+    find(key).settled = true;
+    release();
+}
+
+OrderedMembers::Member&
+OrderedMembers::find(std::string_view key)
+{
+    for (auto& member : members) {
+        if (member.key == key && !member.settled) {
+            return member;
+        }
+    }
+
+    throw std::runtime_error("unexpected or repeated member");
+}
+
+void
+OrderedMembers::release()
+{
+    for (; next < members.size() && members[next].settled; ++next) {
+        auto& member = members[next];
+        if (member.value) {
+            writer.key(member.key).value(*member.value);
+            member.value.reset();
+        }
+    }
+}
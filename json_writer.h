@@ -0,0 +1,131 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <concepts>
+#include <cstddef>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <json.hpp>
+
+
+/**
+ * Streaming JSON emitter. Writes straight to the stream as values are added,
+ * without building a DOM, in the same compact form and escaping as
+ * nlohmann::json's dump(), so output matches it byte for byte for the same
+ * keys in the same order.
+ *
+ * Not thread-safe; callers writing from several threads serialise access.
+ */
+class JsonWriter {
+public:
+    explicit JsonWriter(std::ostream& out);
+
+    JsonWriter& beginObject();
+    JsonWriter& endObject();
+    JsonWriter& beginArray();
+    JsonWriter& endArray();
+
+    // Inside an object, must precede each value
+    JsonWriter& key(std::string_view name);
+
+    JsonWriter& value(std::string_view string);
+    JsonWriter& value(const char* string)
+    {
+        return value(std::string_view(string));
+    }
+    JsonWriter& value(const std::string& string)
+    {
+        return value(std::string_view(string));
+    }
+    JsonWriter& value(bool boolean);
+
+    JsonWriter& value(std::integral auto number)
+    {
+        separate();
+        out << +number;
+        return *this;
+    }
+
+    // For small pre-built fragments
+    JsonWriter& value(const nlohmann::json& fragment);
+
+    // Open objects and arrays
+    size_t depth() const { return scopes.size(); }
+
+    // Closes every open object and array
+    void close();
+
+private:
+    void separate();
+    void writeString(std::string_view string);
+
+    struct Scope {
+        bool isObject;
+        bool isEmpty;
+    };
+
+    std::ostream& out;
+    std::vector<Scope> scopes;
+    bool afterKey = false;
+};
+
+
+/**
+ * Writes members of the writer's current object in a fixed key order while
+ * their values arrive in any order. Each member is held back until every key
+ * before it has been written or dropped, so concurrently produced entries
+ * still come out in the order a DOM would sort them.
+ */
+class OrderedMembers {
+public:
+    // Keys in the order they are to be written
+    OrderedMembers(JsonWriter& writer, std::vector<std::string> keys);
+
+    void write(std::string_view key, nlohmann::json value);
+
+    // For a key that will have no value
+    void drop(std::string_view key);
+
+private:
+    struct Member {
+        std::string key;
+        std::optional<nlohmann::json> value;
+        bool settled = false;
+    };
+
+    Member& find(std::string_view key);
+
+    // Writes out the settled members at the front
+    void release();
+
+    JsonWriter& writer;
+    std::vector<Member> members;
+    size_t next = 0;
+};
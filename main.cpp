@@ -22,14 +22,40 @@ SOFTWARE.
 
 */
 
-#include "HighLevelMonitorConfigurationAPI.h"
-#include "PhysicalMonitorEnumerationAPI.h"
 #include "windows.h"
-#include "winuser.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "accumulator.h"
+#include "async.h"
+#include "bus_lock.h"
+#include "circuit_breaker.h"
+#include "desired_state.h"
+#include "executor.h"
+#include "json_writer.h"
+#include "monitor.h"
+#include "output_buffer.h"
+#include "output_format.h"
+#include "rate_controller.h"
+#include "retry.h"
+#include "server.h"
+#include "snapshot.h"
+#include "state.h"
+#include "sync_point.h"
+#include "value_store.h"
 
 #include <argagg.hpp>
 #include <json.hpp>
@@ -43,200 +69,197 @@ logError(const char* message)
     std::cerr << "error: " << message << std::endl;
 }
 
-
-std::map<std::string, HANDLE> handles;
-
 void
-populateHandlesMap()
+logWarning(const char* message)
 {
-    // Cleanup
-    if (!handles.empty()) {
-        for (auto const& handle : handles) {
-            DestroyPhysicalMonitor(handle.second);
-        }
-        handles.clear();
-    }
-
-
-    struct Monitor {
-        HMONITOR handle;
-        std::vector<HANDLE> physicalHandles;
-    };
-
-    auto monitorEnumProc = [](HMONITOR hMonitor,
-                              HDC hdcMonitor,
-                              LPRECT lprcMonitor,
-                              LPARAM dwData) -> BOOL {
-        auto monitors = reinterpret_cast<std::vector<struct Monitor>*>(dwData);
-        monitors->push_back({ hMonitor, {} });
-        return TRUE;
-    };
-
-    std::vector<struct Monitor> monitors;
-    EnumDisplayMonitors(
-      NULL, NULL, monitorEnumProc, reinterpret_cast<LPARAM>(&monitors));
-
-    // Get physical monitor handles
-    for (auto& monitor : monitors) {
-        DWORD numPhysicalMonitors;
-        LPPHYSICAL_MONITOR physicalMonitors = NULL;
-        if (!GetNumberOfPhysicalMonitorsFromHMONITOR(monitor.handle,
-                                                     &numPhysicalMonitors)) {
-            throw std::runtime_error("Failed to get physical monitor count.");
-            exit(EXIT_FAILURE);
-        }
-
-        physicalMonitors = new PHYSICAL_MONITOR[numPhysicalMonitors];
-        if (physicalMonitors == NULL) {
-            throw std::runtime_error(
-              "Failed to allocate physical monitor array");
-        }
-
-        if (!GetPhysicalMonitorsFromHMONITOR(
-              monitor.handle, numPhysicalMonitors, physicalMonitors)) {
-            throw std::runtime_error("Failed to get physical monitors.");
-        }
-
-        for (DWORD i = 0; i <= numPhysicalMonitors; i++) {
-            monitor.physicalHandles.push_back(
-              physicalMonitors[(numPhysicalMonitors == 1 ? 0 : i)]
-                .hPhysicalMonitor);
-        }
-
-        delete[] physicalMonitors;
-    }
-
-
-    DISPLAY_DEVICE adapterDev;
-    adapterDev.cb = sizeof(DISPLAY_DEVICE);
-
-    // Loop through adapters
-    int adapterDevIndex = 0;
-    while (EnumDisplayDevices(NULL, adapterDevIndex++, &adapterDev, 0)) {
-        DISPLAY_DEVICE displayDev;
-        displayDev.cb = sizeof(DISPLAY_DEVICE);
-
-        // Loop through displays (with device ID) on each adapter
-        int displayDevIndex = 0;
-        while (EnumDisplayDevices(adapterDev.DeviceName,
-                                  displayDevIndex++,
-                                  &displayDev,
-                                  EDD_GET_DEVICE_INTERFACE_NAME)) {
-
-            // Check valid target
-            if (!(displayDev.StateFlags & DISPLAY_DEVICE_ATTACHED_TO_DESKTOP)
-                || displayDev.StateFlags & DISPLAY_DEVICE_MIRRORING_DRIVER) {
-                continue;
-            }
-
-            for (auto const& monitor : monitors) {
-                MONITORINFOEX monitorInfo;
-                monitorInfo.cbSize = sizeof(MONITORINFOEX);
-                GetMonitorInfo(monitor.handle, &monitorInfo);
-
-                for (size_t i = 0; i < monitor.physicalHandles.size(); i++) {
-                    /**
-                     * Re-create DISPLAY_DEVICE.DeviceName with
-                     * MONITORINFOEX.szDevice and monitor index.
-                     */
-                    std::string monitorName =
-                      static_cast<std::string>(monitorInfo.szDevice)
-                      + "\\Monitor" + std::to_string(i);
-
-                    std::string deviceName =
-                      static_cast<std::string>(displayDev.DeviceName);
-
-                    // Match and store against device ID
-                    if (monitorName == deviceName) {
-                        handles.insert(
-                          { static_cast<std::string>(displayDev.DeviceID),
-                            monitor.physicalHandles[i] });
-
-                        break;
-                    }
-                }
-            }
-        }
-    }
+    std::cerr << "warning: " << message << std::endl;
 }
 
+Task<void>
+readVcpFeature(
+  AsyncMonitor& monitor,
+  uint8_t code,
+  std::function<void(const std::string&, Result<VcpFeature>)> done)
+{
+    done(monitor.id(), co_await monitor.tryGetVcp(code));
+}
 
 
-struct MonitorBrightness {
-    unsigned long maximumBrightness;
-    unsigned long currentBrightness;
-};
-
-struct MonitorContrast {
-    unsigned long maximumContrast;
-    unsigned long currentContrast;
+struct LevelArgument {
+    long value;
+    bool isRelative;
 };
 
-MonitorBrightness
-getMonitorBrightness(HANDLE hMonitor)
+/**
+ * Parses a level given to -b/-c: absolute ("40") or relative ("+5", "-5").
+ */
+LevelArgument
+parseLevel(const std::string& arg)
 {
-    DWORD minimumBrightness;
-    DWORD maximumBrightness;
-    DWORD currentBrightness;
-
-    if (!GetMonitorBrightness(hMonitor,
-                              &minimumBrightness,
-                              &currentBrightness,
-                              &maximumBrightness)) {
-        throw std::runtime_error("failed to get monitor brightness");
+    size_t end = 0;
+    long value = 0;
+    try {
+        value = std::stol(arg, &end);
+    } catch (const std::exception&) {
+        end = 0;
     }
 
-    MonitorBrightness brightness = {
-        static_cast<unsigned long>(maximumBrightness),
-        static_cast<unsigned long>(currentBrightness)
-    };
+    if (arg.empty() || end != arg.size()) {
+        throw std::runtime_error("invalid level: " + arg);
+    }
 
-    return brightness;
+    return { value, arg[0] == '+' || arg[0] == '-' };
 }
 
-MonitorContrast
-getMonitorContrast(HANDLE hMonitor)
+/**
+ * Applies a relative adjustment, coalesced with other ddccli processes
+ * adjusting the same monitor and code. The delta goes into a shared
+ * accumulator; whichever process claims it applies the net total in a
+ * single write, so mashing a brightness key costs one transaction.
+ *
+ * Returns the value written, or nullopt if another process is applying
+ * adjustments to this code and will apply this delta along with its own. On
+ * failure the unwritten delta is put back, for the next applier if another
+ * process still has the accumulator open; otherwise it is dropped.
+ */
+Result<std::optional<VcpFeature>>
+adjustVcpFeature(const std::string& id,
+                 HANDLE handle,
+                 uint8_t code,
+                 long delta,
+                 ValueStore& store,
+                 std::optional<std::chrono::milliseconds> trust,
+                 const RetryPolicies& retryPolicies,
+                 unsigned& retries)
 {
-    DWORD minimumContrast;
-    DWORD maximumContrast;
-    DWORD currentContrast;
+    AdjustmentAccumulator accumulator(id, code);
+    accumulator.add(delta);
+
+    BusLock lock(id);
+    auto& controller = busRateController(id);
+    std::optional<VcpFeature> result;
+
+    for (;;) {
+        // Only defer to another adjuster of this code; the bus itself may be
+        // held for anything, so wait for it rather than drop the delta
+        if (!accumulator.tryClaim()) {
+            return result;
+        }
 
-    if (!GetMonitorContrast(
-          hMonitor, &minimumContrast, &currentContrast, &maximumContrast)) {
-        throw std::runtime_error("failed to get monitor contrast");
-    }
+        ScopedBusLock busLock(lock);
+
+        while (long net = accumulator.take()) {
+            VcpFeature current;
+            if (result) {
+                current = *result;
+            } else if (auto cached = trust ? store.get(id, code, *trust)
+                                           : std::nullopt;
+                       cached && cached->maximumValue > 0) {
+                current = *cached;
+            } else if (auto read = retryTransaction(
+                         retryPolicies.read,
+                         [&] {
+                             return pacedTransaction(controller, [&] {
+                                 return tryGetVcpFeature(handle, code);
+                             });
+                         },
+                         retries)) {
+                current = *read;
+            } else {
+                accumulator.add(net);
+                return read.error();
+            }
 
-    MonitorContrast contrast = { static_cast<unsigned long>(maximumContrast),
-                                 static_cast<unsigned long>(currentContrast) };
+            auto target = std::clamp(static_cast<long>(current.currentValue)
+                                       + net,
+                                     0L,
+                                     static_cast<long>(current.maximumValue));
+
+            current.currentValue = static_cast<unsigned long>(target);
+            if (auto written = retryTransaction(
+                  retryPolicies.write,
+                  [&] {
+                      return pacedTransaction(controller, [&] {
+                          return tryWriteVcpFeature(
+                            handle, code, current.currentValue);
+                      });
+                  },
+                  retries);
+                !written) {
+                accumulator.add(net);
+                return written.error();
+            }
 
-    return contrast;
-}
+            store.put(id, code, current);
 
-void
-setMonitorBrightness(HANDLE hMonitor, unsigned long level)
-{
-    auto brightness = getMonitorBrightness(hMonitor);
+            result = current;
+        }
 
-    if (level > brightness.maximumBrightness) {
-        throw std::runtime_error("brightness level exceeds maximum");
-    }
+        lock.release();
+        accumulator.release();
 
-    if (!SetMonitorBrightness(hMonitor, static_cast<DWORD>(level))) {
-        throw std::runtime_error("failed to set monitor brightness");
+        // A delta added after our last take() whose process failed to claim
+        // the accumulator before we released it would otherwise be lost
+        if (accumulator.pending() == 0) {
+            return result;
+        }
     }
 }
 
-void
-setMonitorContrast(HANDLE hMonitor, unsigned long level)
+// Backoff between readiness polls of a monitor being powered on, and how
+// long to keep polling; there is no attempt limit
+constexpr RetryPolicy powerOnPolling = { 0,
+                                         std::chrono::milliseconds(100),
+                                         std::chrono::milliseconds(1000),
+                                         std::chrono::milliseconds(30000) };
+
+/**
+ * Polls a monitor that was told to power on until it answers DDC/CI and
+ * reports itself on. Monitors waking from standby ignore DDC/CI for a
+ * variable time, so polls back off per powerOnPolling instead of waiting a
+ * fixed delay. Failed polls are expected here, so they aren't counted
+ * against the monitor's health.
+ *
+ * Returns the time it took, from the call.
+ */
+Result<std::chrono::milliseconds>
+waitForPowerOn(const std::string& id, HANDLE handle)
 {
-    auto contrast = getMonitorContrast(hMonitor);
+    constexpr VcpCode power = *findVcpCode("power");
+    constexpr uint16_t on = findVcpValue(power, "on")->value;
+
+    BusLock busLock(id);
+    auto& controller = busRateController(id);
+    auto start = std::chrono::steady_clock::now();
+
+    for (unsigned poll = 1;; poll++) {
+        auto state = [&] {
+            ScopedBusLock lock(busLock);
+            return pacedTransaction(controller, [&] {
+                return tryGetVcpFeature(handle, power.code);
+            });
+        }();
+
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - start);
+
+        // A monitor that can't report its power state is at least answering
+        if (state ? state->currentValue == on
+                  : state.error().code == DdcErrorCode::Unsupported) {
+            return elapsed;
+        }
 
-    if (level > contrast.maximumContrast) {
-        throw std::runtime_error("contrast level exceeds maximum");
-    }
+        if (!state && state.error().code == DdcErrorCode::Disconnected) {
+            return state.error();
+        }
+
+        auto delay = retryBackoff(powerOnPolling, poll);
+        if (elapsed + delay > powerOnPolling.deadline) {
+            return DdcError{ DdcErrorCode::Timeout,
+                             "monitor not ready after powering on" };
+        }
 
-    if (!SetMonitorContrast(hMonitor, static_cast<DWORD>(level))) {
-        throw std::runtime_error("failed to set monitor contrast");
+        std::this_thread::sleep_for(delay);
     }
 }
 
@@ -244,20 +267,101 @@ setMonitorContrast(HANDLE hMonitor, unsigned long level)
 int
 main(int argc, char** argv)
 {
+    auto startedAt = std::chrono::steady_clock::now();
+
     argagg::parser parser{
         { { "setBrightness",
             { "-b", "--brightness" },
-            "Sets monitor brightness",
+            "Sets monitor brightness, or adjusts it with a +/- prefix (e.g. -b +5, --brightness=-5)",
             1 },
           { "getBrightness",
             { "-B", "--get-brightness" },
             "Gets monitor brightness",
             0 },
-          { "setContrast", { "-c", "--contrast" }, "Sets monitor contrast", 1 },
+          { "setContrast",
+            { "-c", "--contrast" },
+            "Sets monitor contrast, or adjusts it with a +/- prefix",
+            1 },
           { "getContrast",
             { "-C", "--get-contrast" },
             "Gets monitor contrast",
             0 },
+          { "getVcp",
+            { "--vcp" },
+            "Gets a VCP feature by name (e.g. input) or hex code. If no monitor is selected, reads all monitors.",
+            1 },
+          { "setVcp",
+            { "--set-vcp" },
+            "Sets a VCP feature, given as <feature>=<value>",
+            1 },
+          { "capabilities",
+            { "--capabilities" },
+            "Gets monitor capabilities (supported VCP codes)",
+            0 },
+          { "noCache",
+            { "--no-cache" },
+            "Ignores cached capabilities and re-reads them from the monitor",
+            0 },
+          { "maxAge",
+            { "--max-age" },
+            "Serves reads from values recorded within this many milliseconds instead of querying the monitor",
+            1 },
+          { "trust",
+            { "--trust" },
+            "Skips writes when the value recorded within this many milliseconds already matches",
+            1 },
+          { "force",
+            { "--force" },
+            "Always writes, even if the value is known to be unchanged",
+            0 },
+          { "retry",
+            { "--retry" },
+            "Attempts per operation type, e.g. read=5,write=2,capabilities=1",
+            1 },
+          { "retryDeadline",
+            { "--retry-deadline" },
+            "Gives up retrying an operation after this many milliseconds",
+            1 },
+          { "timeout",
+            { "--timeout" },
+            "Abandons any single DDC/CI call that takes longer than this many milliseconds",
+            1 },
+          { "jobs",
+            { "--jobs" },
+            "Number of threads used for operations across monitors",
+            1 },
+          { "snapshot",
+            { "--snapshot" },
+            "Saves every readable and writable VCP setting of the selected monitors to a file",
+            1 },
+          { "restore",
+            { "--restore" },
+            "Restores settings saved with --snapshot, writing only values that differ",
+            1 },
+          { "preset",
+            { "--preset" },
+            "Applies a named preset of VCP values, writing only values that differ",
+            1 },
+          { "presets",
+            { "--presets" },
+            "Preset file to use instead of %LOCALAPPDATA%\\ddccli\\presets.json",
+            1 },
+          { "power",
+            { "--power" },
+            "Sets the power state: on, standby or off. Turning on waits until each monitor is ready.",
+            1 },
+          { "input",
+            { "--input" },
+            "Switches the input source (e.g. hdmi1, dp1), resolving monitors from the recorded topology for low latency",
+            1 },
+          { "sync",
+            { "--sync" },
+            "Releases the writes of -b, -c, --set-vcp and --power to all monitors at the same instant",
+            0 },
+          { "serve",
+            { "--serve" },
+            "Runs in long-running mode, reading JSON requests from stdin",
+            0 },
           { "help", { "-h", "--help" }, "Prints this help message", 0 },
           { "version", { "-v", "--version" }, "Prints the version number", 0 },
           { "list", { "-l", "--list" }, "Lists connected monitors", 0 },
@@ -265,14 +369,30 @@ main(int argc, char** argv)
             { "-m", "--monitor" },
             "Selects a monitor to adjust. If not specified, actions affects all monitors.",
             1 },
-          { "json", { "-j", "--json" }, "Outputs action results as JSON", 0 } }
+          { "json", { "-j", "--json" }, "Outputs action results as JSON", 0 },
+          { "format",
+            { "--format" },
+            "Output format for results: json, cbor or msgpack (implies -j)",
+            1 } }
     };
 
     std::string versionString = "v0.1.0";
 
+    // Results go out in one write per command (or per chunk when there's a
+    // lot of them) instead of one per line
+    OutputBuffer outputBuffer(std::cout);
+
+    // Reading stdin or logging to stderr would otherwise flush std::cout
+    // first, from whatever thread does it, racing the thread writing results
+    // and costing a write per log line
+    std::cin.tie(nullptr);
+    std::cerr.tie(nullptr);
+
     std::ostringstream usage;
     usage << argv[0] << " " << versionString << std::endl
-          << "Usage: " << argv[0] << " [options]" << std::endl;
+          << "Usage: " << argv[0] << " [options]" << std::endl
+          << "       " << argv[0] << " [options] apply <state.json>"
+          << std::endl;
 
     try {
 
@@ -295,13 +415,88 @@ main(int argc, char** argv)
         }
 
         bool shouldOutputJson = false;
-        json jsonOutput;
         if (args["json"]) {
             shouldOutputJson = true;
         }
 
+        auto outputFormat = OutputFormat::Json;
+        if (args["format"]) {
+            outputFormat = parseOutputFormat(args["format"]);
+            shouldOutputJson = true;
+        }
+
+        prepareOutputStream(stdout, outputFormat);
+
+        // Binary documents are encoded whole, so only text JSON is streamed
+        bool streamJson = shouldOutputJson && !isBinaryFormat(outputFormat);
+
+        json jsonOutput;
+
+        // Sections that can be written as they complete are streamed; the
+        // rest is collected in jsonOutput and follows in key order. That
+        // matches dumping the whole document only while streamed keys come
+        // out in key order and sort before every collected one, which holds
+        // for brightness, capabilities and contrast. Contrast is read before
+        // capabilities, so it is collected when both are asked for.
+        JsonWriter jsonWriter(std::cout);
+        std::mutex outputMutex;
+        bool streamContrast = streamJson && !args["capabilities"];
+
+        // Opens the top-level object on first use
+        auto streamKey = [&](std::string_view name) -> JsonWriter& {
+            if (jsonWriter.depth() == 0) {
+                jsonWriter.beginObject();
+            }
+
+            return jsonWriter.key(name);
+        };
+
+        auto finishJson = [&] {
+            // Nothing streamed: same output as dumping the whole document
+            if (jsonWriter.depth() == 0) {
+                writeDocument(std::cout, jsonOutput, outputFormat);
+                return;
+            }
+
+            if (jsonOutput.is_object()) {
+                for (auto it = jsonOutput.begin(); it != jsonOutput.end();
+                     ++it) {
+                    jsonWriter.key(it.key()).value(*it);
+                }
+            }
+
+            jsonWriter.close();
+            std::cout << '\n';
+        };
+
+        // Set when any monitor fails, without stopping the others
+        std::atomic<bool> anyFailed{ false };
+
+        // Milliseconds between two points, for phase timings
+        auto elapsedMs = [](std::chrono::steady_clock::time_point from,
+                            std::chrono::steady_clock::time_point to) {
+            return std::chrono::duration<double, std::milli>(to - from).count();
+        };
+
+        // Last-known values and monitor health, shared with other
+        // invocations. Saved however the command ends, since failing runs are
+        // what trip breakers.
+        ValueStore store;
+        CircuitBreaker breaker;
+
         try {
-            populateHandlesMap();
+            // Input switching is latency-sensitive, so it opens only the
+            // selected monitors, found through the recorded topology
+            auto enumerationStart = std::chrono::steady_clock::now();
+            if (args["input"]) {
+                populateHandlesMapFromTopology(
+                  args["monitor"]
+                    ? std::optional(args["monitor"].as<std::string>())
+                    : std::nullopt);
+            } else {
+                populateHandlesMap();
+            }
+            auto enumerated = std::chrono::steady_clock::now();
 
             if (args["list"]) {
                 if (shouldOutputJson) {
@@ -312,9 +507,15 @@ main(int argc, char** argv)
                     if (shouldOutputJson) {
                         jsonOutput["monitorList"].push_back(id);
                     } else {
-                        std::cout << id << std::endl;
+                        std::cout << id << '\n';
                     }
                 }
+
+                // Listing doesn't touch the bus, so it needn't wait for what
+                // follows
+                if (!shouldOutputJson) {
+                    std::cout.flush();
+                }
             }
 
 
@@ -322,9 +523,11 @@ main(int argc, char** argv)
                 std::string selectedMonitorName = args["monitor"];
 
                 // Remove all non-matching monitors from the map
-                for (auto const& [ id, handle ] : handles) {
-                    if (id != selectedMonitorName) {
-                        handles.erase(id);
+                for (auto it = handles.begin(); it != handles.end();) {
+                    if (it->first != selectedMonitorName) {
+                        it = handles.erase(it);
+                    } else {
+                        ++it;
                     }
                 }
 
@@ -333,14 +536,605 @@ main(int argc, char** argv)
                 }
             }
 
-            if (args["setBrightness"]) {
-                unsigned long level = args["setBrightness"];
+            // ddccli apply <file> converges monitors to a desired-state
+            // document, validated before anything touches the bus
+            std::optional<DesiredState> desiredState;
+            if (args.pos.size() > 0) {
+                if (std::string_view(args.pos[0]) != "apply") {
+                    throw std::runtime_error(std::string("unknown command: ")
+                                             + args.pos[0]);
+                }
+
+                if (args.pos.size() != 2) {
+                    throw std::runtime_error("expected apply <state.json>");
+                }
+
+                desiredState.emplace(loadJsonDocument(args.pos[1]));
+            }
+
+            if (args["preset"]) {
+                if (desiredState) {
+                    throw std::runtime_error(
+                      "--preset can't be combined with apply");
+                }
+
+                auto path = args["presets"]
+                              ? args["presets"].as<std::string>()
+                              : (getStateDirectory() / "presets.json").string();
+
+                auto presets = loadPresets(path);
+                auto preset = presets.find(args["preset"]);
+                if (preset == presets.end()) {
+                    throw std::runtime_error("no preset named "
+                                             + args["preset"].as<std::string>()
+                                             + " in " + path);
+                }
+
+                desiredState = std::move(preset->second);
+            }
+
+            // A snapshot restores through the same reconciler, as a desired
+            // state for each monitor it has values for
+            if (args["restore"]) {
+                if (desiredState) {
+                    throw std::runtime_error(
+                      "--restore can't be combined with apply or --preset");
+                }
+
+                std::string path = args["restore"];
+                auto contents = readStateFile(path);
+                if (!contents) {
+                    throw std::runtime_error("can't open " + path);
+                }
+
+                auto snapshot = decodeSnapshot(*contents);
+
+                desiredState.emplace();
                 for (auto const& [ id, handle ] : handles) {
-                    setMonitorBrightness(handle, level);
+                    auto it = snapshot.find(hashDeviceId(id));
+                    if (it == snapshot.end()) {
+                        continue;
+                    }
+
+                    for (auto const& saved : it->second) {
+                        if (auto code = findVcpCode(saved.code)) {
+                            desiredState->add(id,
+                                              { *code,
+                                                saved.value,
+                                                std::string(code->name) });
+                        }
+                    }
+
+                    snapshot.erase(it);
+                }
+
+                // Whatever is left was saved from monitors not connected now
+                if (!args["monitor"]) {
+                    for (auto const& [ key, values ] : snapshot) {
+                        if (shouldOutputJson) {
+                            jsonOutput["skipped"][key] = { { "reason",
+                                                             "not-connected" } };
+                        } else {
+                            logWarning(("no connected monitor for saved "
+                                        "settings " + key)
+                                         .c_str());
+                        }
+                    }
                 }
             }
 
-            if (args["getBrightness"]) {
+            constexpr VcpCode powerCode = *findVcpCode("power");
+            constexpr uint16_t powerOn = findVcpValue(powerCode, "on")->value;
+
+            // Only the documented states; hard-off in particular can't be
+            // undone over DDC/CI. --set-vcp power=... still reaches the rest.
+            std::optional<unsigned long> powerState;
+            if (args["power"]) {
+                auto state = args["power"].as<std::string>();
+                if (state != "on" && state != "standby" && state != "off") {
+                    throw std::runtime_error("invalid power state: " + state);
+                }
+
+                powerState =
+                  findVcpValue(powerCode, std::string_view(state))->value;
+            }
+
+            // Relative adjustments are coalesced across processes, which
+            // doesn't leave a single write to line up
+            if (args["sync"]
+                && ((args["setBrightness"]
+                     && parseLevel(args["setBrightness"]).isRelative)
+                    || (args["setContrast"]
+                        && parseLevel(args["setContrast"]).isRelative))) {
+                throw std::runtime_error("--sync needs absolute levels");
+            }
+
+            if (args["timeout"]) {
+                setBackendTimeout(
+                  std::chrono::milliseconds(args["timeout"].as<long>()));
+            }
+
+            auto retryPolicies = defaultRetryPolicies;
+            if (args["retry"]) {
+                retryPolicies = parseRetryPolicies(args["retry"]);
+            }
+
+            if (args["retryDeadline"]) {
+                std::chrono::milliseconds deadline(
+                  args["retryDeadline"].as<long>());
+                retryPolicies.read.deadline = deadline;
+                retryPolicies.write.deadline = deadline;
+                retryPolicies.capabilities.deadline = deadline;
+            }
+
+            if (args["serve"]) {
+                if (jsonWriter.depth() > 0) {
+                    finishJson();
+                }
+
+                return runServer(
+                  std::cin, std::cout, outputFormat, retryPolicies, &store);
+            }
+
+            auto threads =
+              args["jobs"].as<size_t>(defaultExecutorThreads(handles.size()));
+
+            // Synchronised writes wait for each other, so every monitor needs
+            // its own thread to get to the barrier
+            if (args["sync"]) {
+                threads = (std::max)(threads, handles.size());
+            }
+
+            BusExecutor executor(threads);
+
+            std::optional<std::chrono::milliseconds> maxAge;
+            if (args["maxAge"]) {
+                maxAge = std::chrono::milliseconds(args["maxAge"].as<long>());
+            }
+
+            constexpr uint8_t brightnessCode = findVcpCode("brightness")->code;
+            constexpr uint8_t contrastCode = findVcpCode("contrast")->code;
+
+            // Monitors quarantined after repeated failures are skipped until
+            // their cooldown expires, then probed with a single read
+            std::map<std::string, HANDLE> probes;
+            for (auto const& [ id, handle ] : handles) {
+                if (breaker.state(id) == BreakerState::HalfOpen) {
+                    probes.insert({ id, handle });
+                }
+            }
+
+            forEachMonitor(
+              executor, probes, [&](const std::string& id, HANDLE handle) {
+                  BusLock busLock(id);
+                  ScopedBusLock lock(busLock);
+
+                  auto probe = tryGetVcpFeature(handle, brightnessCode);
+                  if (probe || !indicatesUnresponsive(probe.error().code)) {
+                      breaker.recordSuccess(id);
+                  } else {
+                      breaker.recordFailure(id);
+                  }
+              });
+
+            // Monitors that were off have usually failed their way into
+            // quarantine, and powering on is how they come back
+            bool poweringOn = powerState == powerOn;
+
+            std::set<std::string> quarantined;
+            for (auto it = handles.begin(); it != handles.end();) {
+                if (breaker.state(it->first) == BreakerState::Closed
+                    || poweringOn) {
+                    ++it;
+                    continue;
+                }
+
+                auto remaining = breaker.cooldownRemaining(it->first);
+                if (shouldOutputJson) {
+                    jsonOutput["skipped"][it->first] = {
+                        { "reason", "quarantined" },
+                        { "retryInMs", remaining.count() }
+                    };
+                } else {
+                    auto seconds = std::to_string(remaining.count() / 1000);
+                    logWarning((it->first + ": skipped after repeated "
+                                + "failures, retrying in " + seconds + "s")
+                                 .c_str());
+                }
+
+                quarantined.insert(it->first);
+                it = handles.erase(it);
+            }
+
+            // A selected monitor that is quarantined has been reported as
+            // skipped, so reads of it are skipped too rather than failing
+            bool selectedQuarantined =
+              quarantined.count(args["monitor"].as<std::string>("")) > 0;
+
+            auto readThroughStore = [&](const std::string& id,
+                                        uint8_t code,
+                                        auto read) -> VcpFeature {
+                if (maxAge) {
+                    if (auto cached = store.get(id, code, *maxAge)) {
+                        return *cached;
+                    }
+                }
+
+                VcpFeature value = read();
+                store.put(id, code, value);
+                return value;
+            };
+
+            std::optional<std::chrono::milliseconds> trust;
+            if (args["trust"] && !args["force"]) {
+                trust = std::chrono::milliseconds(args["trust"].as<long>());
+            }
+
+            // Write elision: a trusted recent value equal to the requested
+            // one means the write (and its maximum check) can be skipped
+            auto isUnchanged = [&](const std::string& id,
+                                   uint8_t code,
+                                   unsigned long value) {
+                if (!trust) {
+                    return false;
+                }
+
+                auto cached = store.get(id, code, *trust);
+                return cached && cached->currentValue == value;
+            };
+
+            // Per-monitor write results, filled in from executor threads
+            std::mutex resultsMutex;
+
+            // Every bus transaction holds the monitor's cross-process lock,
+            // is paced by its rate controller and retried per policy; time
+            // spent queued behind other processes and retries are reported
+            // per id
+            std::map<std::string, std::chrono::milliseconds> lockWaits;
+            std::map<std::string, unsigned> retryCounts;
+
+            auto recordHealth = [&](const std::string& id, const auto& result) {
+                if (result) {
+                    breaker.recordSuccess(id);
+                } else if (indicatesUnresponsive(result.error().code)) {
+                    breaker.recordFailure(id);
+                }
+            };
+
+            auto transact = [&](const std::string& id,
+                                const RetryPolicy& policy,
+                                auto transaction,
+                                SyncParticipant* sync = nullptr) {
+                BusLock busLock(id);
+                auto& controller = busRateController(id);
+
+                // The bus is taken after the release: holding it at the
+                // barrier could deadlock with another process syncing an
+                // overlapping set of monitors
+                if (sync) {
+                    std::this_thread::sleep_until(controller.nextSlot());
+                    sync->arriveAndWait();
+                }
+
+                ScopedBusLock lock(busLock);
+
+                unsigned retries = 0;
+                auto result = retryTransaction(
+                  policy,
+                  [&] { return pacedTransaction(controller, transaction); },
+                  retries);
+                recordHealth(id, result);
+
+                if (sync && result) {
+                    sync->complete(id);
+                }
+
+                std::lock_guard<std::mutex> guard(resultsMutex);
+                lockWaits[id] += lock.waited;
+                retryCounts[id] += retries;
+
+                return result;
+            };
+
+            // One per synchronised write, covering every selected monitor
+            auto makeSyncPoint = [&]() -> std::unique_ptr<SyncPoint> {
+                if (!args["sync"]) {
+                    return nullptr;
+                }
+
+                return std::make_unique<SyncPoint>(handles.size());
+            };
+
+            auto recordSync = [&](const std::string& feature,
+                                  const SyncPoint* sync) {
+                if (!sync) {
+                    return;
+                }
+
+                if (shouldOutputJson) {
+                    jsonOutput["sync"][feature] = {
+                        { "spreadMs", sync->spread() },
+                        { "completedMs", sync->completionTimes() }
+                    };
+                } else {
+                    std::cout << feature << " completion spread: "
+                              << sync->spread() << "ms" << '\n';
+                }
+            };
+
+            auto recordWrite = [&](const std::string& id,
+                                   const std::string& feature,
+                                   unsigned long value,
+                                   bool unchanged) {
+                if (!shouldOutputJson) {
+                    return;
+                }
+
+                std::lock_guard<std::mutex> lock(resultsMutex);
+                jsonOutput["results"][id][feature] = {
+                    { "value", value },
+                    { "status", unchanged ? "unchanged" : "written" }
+                };
+            };
+
+            auto recordRetries = [&](const std::string& id, unsigned retries) {
+                std::lock_guard<std::mutex> lock(resultsMutex);
+                retryCounts[id] += retries;
+            };
+
+            auto recordError = [&](const std::string& id,
+                                   const std::string& feature,
+                                   const DdcError& error) {
+                anyFailed = true;
+
+                std::lock_guard<std::mutex> lock(resultsMutex);
+                if (shouldOutputJson) {
+                    jsonOutput["results"][id][feature] = {
+                        { "status", "error" },
+                        { "error", std::string(to_string(error.code)) },
+                        { "message", error.message }
+                    };
+                } else {
+                    logError((id + ": " + error.message).c_str());
+                }
+            };
+
+            auto recordAdjustment = [&](const std::string& id,
+                                        const std::string& feature,
+                                        std::optional<VcpFeature> result) {
+                if (!shouldOutputJson) {
+                    return;
+                }
+
+                std::lock_guard<std::mutex> lock(resultsMutex);
+                if (result) {
+                    jsonOutput["results"][id][feature] = {
+                        { "value", result->currentValue },
+                        { "status", "written" }
+                    };
+                } else {
+                    jsonOutput["results"][id][feature] = { { "status",
+                                                             "coalesced" } };
+                }
+            };
+
+            // First, so other changes reach monitors that are awake
+            if (powerState) {
+                auto syncPoint = makeSyncPoint();
+                forEachMonitor(
+                  executor, handles, [&](const std::string& id, HANDLE handle) {
+                      SyncParticipant sync(syncPoint.get());
+                      if (isUnchanged(id, powerCode.code, *powerState)) {
+                          recordWrite(id, "power", *powerState, true);
+                          return;
+                      }
+
+                      auto written = transact(
+                        id,
+                        retryPolicies.write,
+                        [&] {
+                            return tryWriteVcpFeature(
+                              handle, powerCode.code, *powerState);
+                        },
+                        sync ? &sync : nullptr);
+                      if (!written) {
+                          recordError(id, "power", written.error());
+                          return;
+                      }
+
+                      store.put(id, powerCode.code, { 0, *powerState });
+                      recordWrite(id, "power", *powerState, false);
+
+                      if (*powerState != powerOn) {
+                          return;
+                      }
+
+                      auto ready = waitForPowerOn(id, handle);
+                      if (!ready) {
+                          recordError(id, "power", ready.error());
+                          return;
+                      }
+
+                      breaker.recordSuccess(id);
+
+                      if (shouldOutputJson) {
+                          std::lock_guard<std::mutex> lock(resultsMutex);
+                          jsonOutput["results"][id]["power"]["readyMs"] =
+                            ready->count();
+                      } else {
+                          std::lock_guard<std::mutex> lock(outputMutex);
+                          std::cout << id << " ready after " << ready->count()
+                                    << "ms" << '\n';
+                      }
+                  });
+
+                recordSync("power", syncPoint.get());
+            }
+
+            if (args["input"]) {
+                constexpr VcpCode inputCode = *findVcpCode("input");
+                auto source = parseVcpValue(inputCode, args["input"]);
+
+                std::map<std::string, double> validateTimes;
+                std::map<std::string, double> writeTimes;
+
+                forEachMonitor(
+                  executor, handles, [&](const std::string& id, HANDLE handle) {
+                      auto start = std::chrono::steady_clock::now();
+
+                      // Checked against cached capabilities only; probing the
+                      // monitor would cost more than the switch itself
+                      if (auto capabilities = cachedMonitorCapabilities(id)) {
+                          auto allowed =
+                            capabilities->allowedValues(inputCode.code);
+                          if (!allowed.empty()
+                              && std::find(allowed.begin(),
+                                           allowed.end(),
+                                           source) == allowed.end()) {
+                              recordError(id,
+                                          "input",
+                                          { DdcErrorCode::Unsupported,
+                                            "input source not listed by "
+                                            "monitor" });
+                              return;
+                          }
+                      }
+
+                      auto validated = std::chrono::steady_clock::now();
+
+                      if (isUnchanged(id, inputCode.code, source)) {
+                          recordWrite(id, "input", source, true);
+                      } else if (auto written =
+                                   transact(id, retryPolicies.write, [&] {
+                                       return tryWriteVcpFeature(
+                                         handle, inputCode.code, source);
+                                   });
+                                 !written) {
+                          recordError(id, "input", written.error());
+                      } else {
+                          store.put(id, inputCode.code, { 0, source });
+                          recordWrite(id, "input", source, false);
+                      }
+
+                      auto done = std::chrono::steady_clock::now();
+
+                      std::lock_guard<std::mutex> lock(resultsMutex);
+                      validateTimes[id] = elapsedMs(start, validated);
+                      writeTimes[id] = elapsedMs(validated, done);
+                  });
+
+                if (shouldOutputJson) {
+                    jsonOutput["latencyMs"] = {
+                        { "enumerate",
+                          elapsedMs(enumerationStart, enumerated) },
+                        { "validate", validateTimes },
+                        { "write", writeTimes },
+                        { "total",
+                          elapsedMs(startedAt,
+                                    std::chrono::steady_clock::now()) }
+                    };
+                }
+            }
+
+            // trySetVcpFeature and the -b/-c setters read the maximum of a
+            // continuous code before writing. When synchronised, that read
+            // is done ahead of the sync point so only the write itself is
+            // lined up across monitors.
+            auto writeSynchronised = [&](const std::string& id,
+                                         HANDLE handle,
+                                         uint8_t code,
+                                         const std::string& feature,
+                                         unsigned long value,
+                                         SyncParticipant& sync) {
+                auto current = transact(id, retryPolicies.read, [&] {
+                    return tryGetVcpFeature(handle, code);
+                });
+                if (!current) {
+                    recordError(id, feature, current.error());
+                    return;
+                }
+
+                if (value > current->maximumValue) {
+                    recordError(id,
+                                feature,
+                                { DdcErrorCode::OutOfRange,
+                                  feature + " value exceeds maximum" });
+                    return;
+                }
+
+                auto written = transact(
+                  id,
+                  retryPolicies.write,
+                  [&] { return tryWriteVcpFeature(handle, code, value); },
+                  &sync);
+                if (!written) {
+                    recordError(id, feature, written.error());
+                    return;
+                }
+
+                store.put(id, code, { current->maximumValue, value });
+                recordWrite(id, feature, value, false);
+            };
+
+            if (args["setBrightness"]
+                && parseLevel(args["setBrightness"]).isRelative) {
+                auto delta = parseLevel(args["setBrightness"]).value;
+                forEachMonitor(
+                  executor, handles, [&](const std::string& id, HANDLE handle) {
+                      unsigned retries = 0;
+                      auto result = adjustVcpFeature(id,
+                                                     handle,
+                                                     brightnessCode,
+                                                     delta,
+                                                     store,
+                                                     trust,
+                                                     retryPolicies,
+                                                     retries);
+                      recordRetries(id, retries);
+                      recordHealth(id, result);
+                      if (result) {
+                          recordAdjustment(id, "brightness", *result);
+                      } else {
+                          recordError(id, "brightness", result.error());
+                      }
+                  });
+            } else if (args["setBrightness"]) {
+                unsigned long level = parseLevel(args["setBrightness"]).value;
+                auto syncPoint = makeSyncPoint();
+                forEachMonitor(
+                  executor, handles, [&](const std::string& id, HANDLE handle) {
+                      SyncParticipant sync(syncPoint.get());
+                      if (isUnchanged(id, brightnessCode, level)) {
+                          recordWrite(id, "brightness", level, true);
+                          return;
+                      }
+
+                      if (sync) {
+                          writeSynchronised(
+                            id, handle, brightnessCode, "brightness", level, sync);
+                          return;
+                      }
+
+                      auto brightness = transact(
+                        id,
+                        retryPolicies.write,
+                        [&] { return trySetMonitorBrightness(handle, level); });
+                      if (!brightness) {
+                          recordError(id, "brightness", brightness.error());
+                          return;
+                      }
+
+                      store.put(id,
+                                brightnessCode,
+                                { brightness->maximumBrightness,
+                                  brightness->currentBrightness });
+                      recordWrite(id, "brightness", level, false);
+                  });
+
+                recordSync("brightness", syncPoint.get());
+            }
+
+            if (args["getBrightness"] && !selectedQuarantined) {
                 if (args["monitor"]) {
                     auto it = handles.find(args["monitor"]);
                     if (it == handles.end()) {
@@ -348,12 +1142,21 @@ main(int argc, char** argv)
                     }
 
                     auto brightness =
-                      getMonitorBrightness(it->second).currentBrightness;
-
-                    if (shouldOutputJson) {
+                      readThroughStore(it->first, brightnessCode, [&] {
+                          auto value =
+                            transact(it->first, retryPolicies.read, [&] {
+                                return tryGetMonitorBrightness(it->second);
+                            }).value();
+                          return VcpFeature{ value.maximumBrightness,
+                                             value.currentBrightness };
+                      }).currentValue;
+
+                    if (streamJson) {
+                        streamKey("brightness").value(brightness);
+                    } else if (shouldOutputJson) {
                         jsonOutput["brightness"] = brightness;
                     } else {
-                        std::cout << brightness << std::endl;
+                        std::cout << brightness << '\n';
                     }
                 } else {
                     throw std::runtime_error(
@@ -361,14 +1164,65 @@ main(int argc, char** argv)
                 }
             }
 
-            if (args["setContrast"]) {
-                unsigned long level = args["setContrast"];
-                for (auto const& [ id, handle ] : handles) {
-                    setMonitorContrast(handle, level);
-                }
+            if (args["setContrast"]
+                && parseLevel(args["setContrast"]).isRelative) {
+                auto delta = parseLevel(args["setContrast"]).value;
+                forEachMonitor(
+                  executor, handles, [&](const std::string& id, HANDLE handle) {
+                      unsigned retries = 0;
+                      auto result = adjustVcpFeature(id,
+                                                     handle,
+                                                     contrastCode,
+                                                     delta,
+                                                     store,
+                                                     trust,
+                                                     retryPolicies,
+                                                     retries);
+                      recordRetries(id, retries);
+                      recordHealth(id, result);
+                      if (result) {
+                          recordAdjustment(id, "contrast", *result);
+                      } else {
+                          recordError(id, "contrast", result.error());
+                      }
+                  });
+            } else if (args["setContrast"]) {
+                unsigned long level = parseLevel(args["setContrast"]).value;
+                auto syncPoint = makeSyncPoint();
+                forEachMonitor(
+                  executor, handles, [&](const std::string& id, HANDLE handle) {
+                      SyncParticipant sync(syncPoint.get());
+                      if (isUnchanged(id, contrastCode, level)) {
+                          recordWrite(id, "contrast", level, true);
+                          return;
+                      }
+
+                      if (sync) {
+                          writeSynchronised(
+                            id, handle, contrastCode, "contrast", level, sync);
+                          return;
+                      }
+
+                      auto contrast = transact(
+                        id,
+                        retryPolicies.write,
+                        [&] { return trySetMonitorContrast(handle, level); });
+                      if (!contrast) {
+                          recordError(id, "contrast", contrast.error());
+                          return;
+                      }
+
+                      store.put(id,
+                                contrastCode,
+                                { contrast->maximumContrast,
+                                  contrast->currentContrast });
+                      recordWrite(id, "contrast", level, false);
+                  });
+
+                recordSync("contrast", syncPoint.get());
             }
 
-            if (args["getContrast"]) {
+            if (args["getContrast"] && !selectedQuarantined) {
                 if (args["monitor"]) {
                     auto it = handles.find(args["monitor"]);
                     if (it == handles.end()) {
@@ -376,25 +1230,388 @@ main(int argc, char** argv)
                     }
 
                     auto contrast =
-                      getMonitorContrast(it->second).currentContrast;
-
-                    if (shouldOutputJson) {
+                      readThroughStore(it->first, contrastCode, [&] {
+                          auto value =
+                            transact(it->first, retryPolicies.read, [&] {
+                                return tryGetMonitorContrast(it->second);
+                            }).value();
+                          return VcpFeature{ value.maximumContrast,
+                                             value.currentContrast };
+                      }).currentValue;
+
+                    if (streamContrast) {
+                        streamKey("contrast").value(contrast);
+                    } else if (shouldOutputJson) {
                         jsonOutput["contrast"] = contrast;
                     } else {
-                        std::cout << contrast << std::endl;
+                        std::cout << contrast << '\n';
                     }
                 } else {
                     throw std::runtime_error(
                       "no monitor specified to query contrast");
                 }
             }
-        } catch (const std::runtime_error e) {
+
+            if (args["setVcp"]) {
+                std::string assignment = args["setVcp"];
+
+                auto separator = assignment.find('=');
+                if (separator == std::string::npos) {
+                    throw std::runtime_error(
+                      "expected <feature>=<value> for --set-vcp");
+                }
+
+                auto code = parseVcpCode(assignment.substr(0, separator));
+                auto value =
+                  parseVcpValue(code, assignment.substr(separator + 1));
+
+                auto feature = code.name.empty()
+                                 ? assignment.substr(0, separator)
+                                 : std::string(code.name);
+
+                auto syncPoint = makeSyncPoint();
+                forEachMonitor(
+                  executor, handles, [&](const std::string& id, HANDLE handle) {
+                      SyncParticipant sync(syncPoint.get());
+                      if (isUnchanged(id, code.code, value)) {
+                          recordWrite(id, feature, value, true);
+                          return;
+                      }
+
+                      if (sync && code.type == VcpType::Continuous) {
+                          writeSynchronised(
+                            id, handle, code.code, feature, value, sync);
+                          return;
+                      }
+
+                      auto result = transact(
+                        id,
+                        retryPolicies.write,
+                        [&] { return trySetVcpFeature(handle, code, value); },
+                        sync ? &sync : nullptr);
+                      if (!result) {
+                          recordError(id, feature, result.error());
+                          return;
+                      }
+
+                      store.put(id, code.code, *result);
+                      recordWrite(id, feature, value, false);
+                  });
+
+                recordSync(feature, syncPoint.get());
+            }
+
+            // Compares each desired value with what is trusted from the store
+            // (see --trust) or, failing that, read from the monitor, and
+            // writes only the ones that differ. A converged monitor costs one
+            // read per value, or nothing when the store is trusted.
+            auto reconcile = [&](const DesiredState& state) {
+                forEachMonitor(
+                  executor, handles, [&](const std::string& id, HANDLE handle) {
+                      for (auto const& desired : state.valuesFor(id)) {
+                          auto const& code = desired.code;
+                          auto const& feature = desired.feature;
+
+                          auto fail = [&](const DdcError& error) {
+                              recordError(id, feature, error);
+
+                              // No point queueing more for a monitor that
+                              // has stopped answering
+                              return breaker.state(id) != BreakerState::Closed;
+                          };
+
+                          std::optional<VcpFeature> current;
+                          if (trust) {
+                              current = store.get(id, code.code, *trust);
+                          }
+
+                          if (!current && code.isReadable()) {
+                              auto read = transact(id, retryPolicies.read, [&] {
+                                  return tryGetVcpFeature(handle, code.code);
+                              });
+                              if (!read) {
+                                  if (fail(read.error())) {
+                                      return;
+                                  }
+                                  continue;
+                              }
+
+                              store.put(id, code.code, *read);
+                              current = *read;
+                          }
+
+                          if (current
+                              && current->currentValue == desired.value) {
+                              recordWrite(id, feature, desired.value, true);
+                              continue;
+                          }
+
+                          if (code.type == VcpType::Continuous && current
+                              && current->maximumValue > 0
+                              && desired.value > current->maximumValue) {
+                              fail({ DdcErrorCode::OutOfRange,
+                                     "vcp value exceeds maximum" });
+                              continue;
+                          }
+
+                          auto written = transact(id, retryPolicies.write, [&] {
+                              return tryWriteVcpFeature(
+                                handle, code.code, desired.value);
+                          });
+                          if (!written) {
+                              if (fail(written.error())) {
+                                  return;
+                              }
+                              continue;
+                          }
+
+                          store.put(id, code.code, { 0, desired.value });
+                          recordWrite(id, feature, desired.value, false);
+                      }
+                  });
+            };
+
+            if (desiredState) {
+                reconcile(*desiredState);
+            }
+
+            // A cache hit is served without queueing for the bus; only a
+            // miss (or --no-cache) becomes a transaction
+            auto readCapabilities =
+              [&](const std::string& id,
+                  HANDLE handle) -> Result<MonitorCapabilities> {
+                if (!args["noCache"]) {
+                    if (auto cached = cachedMonitorCapabilities(id)) {
+                        return std::move(*cached);
+                    }
+                }
+
+                return transact(id, retryPolicies.capabilities, [&] {
+                    return tryGetMonitorCapabilities(handle, id, false);
+                });
+            };
+
+            if (args["snapshot"]) {
+                Snapshot snapshot;
+
+                forEachMonitor(
+                  executor, handles, [&](const std::string& id, HANDLE handle) {
+                      auto capabilities = readCapabilities(id, handle);
+                      if (!capabilities) {
+                          recordError(id, "snapshot", capabilities.error());
+                          return;
+                      }
+
+                      std::vector<SnapshotValue> values;
+                      for (auto code : snapshotCodes(*capabilities)) {
+                          std::string feature(findVcpCode(code)->name);
+
+                          auto read = transact(id, retryPolicies.read, [&] {
+                              return tryGetVcpFeature(handle, code);
+                          });
+                          if (!read) {
+                              recordError(id, feature, read.error());
+                              if (breaker.state(id) != BreakerState::Closed) {
+                                  return;
+                              }
+                              continue;
+                          }
+
+                          store.put(id, code, *read);
+                          auto value =
+                            static_cast<uint16_t>(read->currentValue);
+                          values.push_back({ code, value });
+                      }
+
+                      std::lock_guard<std::mutex> lock(resultsMutex);
+                      if (shouldOutputJson) {
+                          auto& saved = jsonOutput["snapshot"][id];
+                          saved = json::object();
+                          for (auto const& value : values) {
+                              std::string name(findVcpCode(value.code)->name);
+                              saved[name] = value.value;
+                          }
+                      }
+
+                      snapshot[hashDeviceId(id)] = std::move(values);
+                  });
+
+                writeStateFile(args["snapshot"].as<std::string>(),
+                               encodeSnapshot(snapshot));
+            }
+
+            if (args["getVcp"]) {
+                auto code = parseVcpCode(args["getVcp"]);
+                if (!code.isReadable()) {
+                    throw std::runtime_error("vcp feature is write-only");
+                }
+
+                // A single selected monitor keeps the flat output format.
+                // JSON is collected, since "vcp" sorts after the results and
+                // timings the reads themselves add to.
+                auto emitVcp = [&](const std::string& id,
+                                   const Result<VcpFeature>& result) {
+                    if (!result) {
+                        recordError(id, "vcp", result.error());
+                        return;
+                    }
+
+                    auto const& value = *result;
+
+                    std::lock_guard<std::mutex> lock(outputMutex);
+                    if (shouldOutputJson) {
+                        json flat = { { "code", code.code },
+                                      { "value", value.currentValue },
+                                      { "maximum", value.maximumValue } };
+
+                        if (!code.name.empty()) {
+                            flat["name"] = std::string(code.name);
+                        }
+
+                        if (args["monitor"]) {
+                            jsonOutput["vcp"] = flat;
+                        } else {
+                            jsonOutput["vcp"][id] = flat;
+                        }
+                    } else if (args["monitor"]) {
+                        std::cout << formatVcpValue(code, value.currentValue)
+                                  << '\n';
+                    } else {
+                        std::cout << id << " "
+                                  << formatVcpValue(code, value.currentValue)
+                                  << '\n';
+                    }
+
+                    // Each monitor goes out as soon as its value arrives
+                    if (!shouldOutputJson) {
+                        std::cout.flush();
+                    }
+                };
+
+                // Read every selected monitor concurrently from one thread
+                EventLoop loop;
+                std::vector<std::unique_ptr<AsyncMonitor>> monitors;
+
+                for (auto const& [ id, handle ] : handles) {
+                    if (maxAge) {
+                        if (auto cached = store.get(id, code.code, *maxAge)) {
+                            emitVcp(id, *cached);
+                            continue;
+                        }
+                    }
+
+                    monitors.push_back(std::make_unique<AsyncMonitor>(
+                      loop, executor, id, handle, retryPolicies));
+                    loop.spawn(readVcpFeature(
+                      *monitors.back(),
+                      code.code,
+                      [&](const std::string& id, Result<VcpFeature> value) {
+                          if (value) {
+                              store.put(id, code.code, *value);
+                          }
+                          recordHealth(id, value);
+                          emitVcp(id, value);
+                      }));
+                }
+
+                loop.run();
+
+                for (auto const& monitor : monitors) {
+                    lockWaits[monitor->id()] += monitor->lockWaitTime();
+                    retryCounts[monitor->id()] += monitor->retryCount();
+                }
+            }
+
+            if (args["capabilities"]) {
+                // Each monitor is written out as soon as it and those sorting
+                // before it complete
+                std::optional<OrderedMembers> streamed;
+                if (streamJson) {
+                    streamKey("capabilities").beginObject();
+
+                    std::vector<std::string> ids;
+                    for (auto const& [ id, handle ] : handles) {
+                        ids.push_back(id);
+                    }
+                    streamed.emplace(jsonWriter, std::move(ids));
+                } else if (shouldOutputJson) {
+                    jsonOutput["capabilities"] = json::object();
+                }
+
+                forEachMonitor(
+                  executor, handles, [&](const std::string& id, HANDLE handle) {
+                      auto capabilities = readCapabilities(id, handle);
+                      if (!capabilities) {
+                          recordError(id, "capabilities", capabilities.error());
+                          if (streamed) {
+                              std::lock_guard<std::mutex> lock(outputMutex);
+                              streamed->drop(id);
+                          }
+                          return;
+                      }
+
+                      std::lock_guard<std::mutex> lock(outputMutex);
+                      if (streamed) {
+                          streamed->write(id, *capabilities);
+                      } else if (shouldOutputJson) {
+                          jsonOutput["capabilities"][id] = *capabilities;
+                      } else {
+                          std::cout << id << " " << capabilities->raw
+                                    << '\n';
+                      }
+
+                      if (streamJson || !shouldOutputJson) {
+                          std::cout.flush();
+                      }
+                  });
+
+                if (streamJson) {
+                    jsonWriter.endObject();
+                }
+            }
+
+            if (shouldOutputJson) {
+                // Only monitors that had to wait or retry, as in --serve
+                // responses
+                for (auto const& [ id, waited ] : lockWaits) {
+                    if (waited.count() > 0) {
+                        jsonOutput["lockWaitMs"][id] = waited.count();
+                    }
+                }
+
+                for (auto const& [ id, retries ] : retryCounts) {
+                    if (retries > 0) {
+                        jsonOutput["retries"][id] = retries;
+                    }
+                }
+            }
+
+            store.save();
+            breaker.save();
+        } catch (const std::runtime_error& e) {
+            // Keep stdout valid JSON if part of it has gone out already
+            if (jsonWriter.depth() > 0) {
+                finishJson();
+            }
+
             logError(e.what());
+
+            try {
+                store.save();
+                breaker.save();
+            } catch (const std::runtime_error& saveError) {
+                logError(saveError.what());
+            }
+
             return EXIT_FAILURE;
         }
 
         if (shouldOutputJson) {
-            std::cout << jsonOutput << std::endl;
+            finishJson();
+        }
+
+        if (anyFailed) {
+            return EXIT_FAILURE;
         }
 
     } catch (const std::exception& e) {
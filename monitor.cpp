@@ -0,0 +1,805 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "monitor.h"
+
+#include "HighLevelMonitorConfigurationAPI.h"
+#include "LowLevelMonitorConfigurationAPI.h"
+#include "PhysicalMonitorEnumerationAPI.h"
+#include "winuser.h"
+
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "bus_lock.h"
+#include "state.h"
+
+#include <json.hpp>
+
+using json = nlohmann::json;
+
+
+std::map<std::string, HANDLE> handles;
+
+
+namespace {
+
+std::optional<std::chrono::milliseconds> backendTimeout;
+
+// Backend calls still running per monitor, including abandoned ones. Never
+// freed, as abandoned calls may outlive static destruction.
+struct InFlightCalls {
+    std::mutex mutex;
+    std::map<HANDLE, unsigned> counts;
+};
+
+InFlightCalls&
+inFlightCalls()
+{
+    static auto calls = new InFlightCalls;
+    return *calls;
+}
+
+// The DeviceID a physical monitor handle was opened as
+std::string
+deviceIdFor(HANDLE hMonitor)
+{
+    for (auto const& [ id, handle ] : handles) {
+        if (handle == hMonitor) {
+            return id;
+        }
+    }
+
+    return {};
+}
+
+/**
+ * Runs a dxva2 call, which returns a reply struct with its outputs. The call
+ * holds the monitor's BusActivity until it returns, waiting first for any
+ * call another process abandoned. With a timeout set, the call runs on its
+ * own thread and is abandoned if it doesn't return in time, so fn must own
+ * everything it touches.
+ *
+ * Returns nullopt on timeout, including when the bus stays busy with another
+ * process's abandoned call, and straight away while an earlier abandoned
+ * call on the same monitor is still stuck. GetLastError() is carried over to
+ * the calling thread.
+ */
+template<typename Fn>
+auto
+runBackendCall(HANDLE hMonitor, Fn fn) -> std::optional<decltype(fn())>
+{
+    auto id = deviceIdFor(hMonitor);
+
+    if (!backendTimeout) {
+        BusActivity activity(id);
+        activity.acquire();
+        return fn();
+    }
+
+    using Reply = decltype(fn());
+    auto& calls = inFlightCalls();
+
+    {
+        std::lock_guard<std::mutex> lock(calls.mutex);
+        if (calls.counts[hMonitor] > 0) {
+            return std::nullopt;
+        }
+
+        calls.counts[hMonitor]++;
+    }
+
+    auto timeout = static_cast<DWORD>(backendTimeout->count());
+    auto task = std::make_shared<
+      std::packaged_task<std::pair<std::optional<Reply>, DWORD>()>>(
+      [hMonitor, id, timeout, fn = std::move(fn), &calls] {
+          std::optional<Reply> reply;
+          DWORD error = 0;
+
+          // Holding the bus past the caller giving up is the point: the
+          // next transaction mustn't talk over this call
+          {
+              BusActivity activity(id);
+              if (activity.acquire(timeout)) {
+                  reply = fn();
+                  error = GetLastError();
+              }
+          }
+
+          std::lock_guard<std::mutex> lock(calls.mutex);
+          calls.counts[hMonitor]--;
+
+          return std::make_pair(std::move(reply), error);
+      });
+
+    auto future = task->get_future();
+    std::thread([task] { (*task)(); }).detach();
+
+    if (future.wait_for(*backendTimeout) != std::future_status::ready) {
+        return std::nullopt;
+    }
+
+    auto [ reply, error ] = future.get();
+    SetLastError(error);
+
+    return reply;
+}
+
+std::filesystem::path
+topologyPath()
+{
+    return getStateDirectory() / "topology.json";
+}
+
+std::filesystem::path
+capabilitiesCachePath(const std::string& deviceId)
+{
+    return getStateDirectory() / "capabilities"
+           / (hashDeviceId(deviceId) + ".txt");
+}
+
+DdcError
+timedOut(const std::string& request)
+{
+    return { DdcErrorCode::Timeout, request + " timed out" };
+}
+
+struct ValueReply {
+    BOOL ok = FALSE;
+    DWORD minimum = 0;
+    DWORD current = 0;
+    DWORD maximum = 0;
+};
+
+} // namespace
+
+
+void
+setBackendTimeout(std::optional<std::chrono::milliseconds> timeout)
+{
+    backendTimeout = timeout;
+}
+
+void
+populateHandlesMap()
+{
+    // DeviceID -> display name and index of the physical monitor on it
+    json topology = json::object();
+
+    // Cleanup
+    if (!handles.empty()) {
+        for (auto const& handle : handles) {
+            DestroyPhysicalMonitor(handle.second);
+        }
+        handles.clear();
+    }
+
+
+    struct Monitor {
+        HMONITOR handle;
+        std::vector<HANDLE> physicalHandles;
+    };
+
+    auto monitorEnumProc = [](HMONITOR hMonitor,
+                              HDC hdcMonitor,
+                              LPRECT lprcMonitor,
+                              LPARAM dwData) -> BOOL {
+        auto monitors = reinterpret_cast<std::vector<struct Monitor>*>(dwData);
+        monitors->push_back({ hMonitor, {} });
+        return TRUE;
+    };
+
+    std::vector<struct Monitor> monitors;
+    EnumDisplayMonitors(
+      NULL, NULL, monitorEnumProc, reinterpret_cast<LPARAM>(&monitors));
+
+    // Get physical monitor handles
+    for (auto& monitor : monitors) {
+        DWORD numPhysicalMonitors;
+        LPPHYSICAL_MONITOR physicalMonitors = NULL;
+        if (!GetNumberOfPhysicalMonitorsFromHMONITOR(monitor.handle,
+                                                     &numPhysicalMonitors)) {
+            throw std::runtime_error("Failed to get physical monitor count.");
+            exit(EXIT_FAILURE);
+        }
+
+        physicalMonitors = new PHYSICAL_MONITOR[numPhysicalMonitors];
+        if (physicalMonitors == NULL) {
+            throw std::runtime_error(
+              "Failed to allocate physical monitor array");
+        }
+
+        if (!GetPhysicalMonitorsFromHMONITOR(
+              monitor.handle, numPhysicalMonitors, physicalMonitors)) {
+            throw std::runtime_error("Failed to get physical monitors.");
+        }
+
+        for (DWORD i = 0; i <= numPhysicalMonitors; i++) {
+            monitor.physicalHandles.push_back(
+              physicalMonitors[(numPhysicalMonitors == 1 ? 0 : i)]
+                .hPhysicalMonitor);
+        }
+
+        delete[] physicalMonitors;
+    }
+
+
+    DISPLAY_DEVICE adapterDev;
+    adapterDev.cb = sizeof(DISPLAY_DEVICE);
+
+    // Loop through adapters
+    int adapterDevIndex = 0;
+    while (EnumDisplayDevices(NULL, adapterDevIndex++, &adapterDev, 0)) {
+        DISPLAY_DEVICE displayDev;
+        displayDev.cb = sizeof(DISPLAY_DEVICE);
+
+        // Loop through displays (with device ID) on each adapter
+        int displayDevIndex = 0;
+        while (EnumDisplayDevices(adapterDev.DeviceName,
+                                  displayDevIndex++,
+                                  &displayDev,
+                                  EDD_GET_DEVICE_INTERFACE_NAME)) {
+
+            // Check valid target
+            if (!(displayDev.StateFlags & DISPLAY_DEVICE_ATTACHED_TO_DESKTOP)
+                || displayDev.StateFlags & DISPLAY_DEVICE_MIRRORING_DRIVER) {
+                continue;
+            }
+
+            for (auto const& monitor : monitors) {
+                MONITORINFOEX monitorInfo;
+                monitorInfo.cbSize = sizeof(MONITORINFOEX);
+                GetMonitorInfo(monitor.handle, &monitorInfo);
+
+                for (size_t i = 0; i < monitor.physicalHandles.size(); i++) {
+                    /**
+                     * Re-create DISPLAY_DEVICE.DeviceName with
+                     * MONITORINFOEX.szDevice and monitor index.
+                     */
+                    std::string monitorName =
+                      static_cast<std::string>(monitorInfo.szDevice)
+                      + "\\Monitor" + std::to_string(i);
+
+                    std::string deviceName =
+                      static_cast<std::string>(displayDev.DeviceName);
+
+                    // Match and store against device ID
+                    if (monitorName == deviceName) {
+                        handles.insert(
+                          { static_cast<std::string>(displayDev.DeviceID),
+                            monitor.physicalHandles[i] });
+
+                        topology[displayDev.DeviceID] = {
+                            { "display", monitorInfo.szDevice }, { "index", i }
+                        };
+
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    auto recorded = readStateFile(topologyPath());
+    if (!recorded || *recorded != topology.dump()) {
+        writeStateFile(topologyPath(), topology.dump());
+    }
+}
+
+void
+populateHandlesMapFromTopology(const std::optional<std::string>& selected)
+{
+    json topology;
+    try {
+        if (auto recorded = readStateFile(topologyPath())) {
+            topology = json::parse(*recorded);
+        }
+    } catch (const std::exception&) {
+        // Corrupt record, enumerate in full
+    }
+
+    // Display name -> (index, DeviceID) of the monitors wanted on it
+    std::map<std::string, std::vector<std::pair<size_t, std::string>>> wanted;
+    std::map<std::string, size_t> recordedDisplays;
+    size_t wantedCount = 0;
+
+    if (topology.is_object()) {
+        for (auto it = topology.begin(); it != topology.end(); ++it) {
+            auto display = it->value("display", "");
+            recordedDisplays[display]++;
+
+            if (!selected || it.key() == *selected) {
+                wanted[display].push_back(
+                  { it->value("index", size_t(0)), it.key() });
+                wantedCount++;
+            }
+        }
+    }
+
+    if (wantedCount == 0) {
+        populateHandlesMap();
+        return;
+    }
+
+    for (auto const& handle : handles) {
+        DestroyPhysicalMonitor(handle.second);
+    }
+    handles.clear();
+
+    auto monitorEnumProc = [](HMONITOR hMonitor,
+                              HDC /*hdcMonitor*/,
+                              LPRECT /*lprcMonitor*/,
+                              LPARAM dwData) -> BOOL {
+        reinterpret_cast<std::vector<HMONITOR>*>(dwData)->push_back(hMonitor);
+        return TRUE;
+    };
+
+    std::vector<HMONITOR> monitors;
+    EnumDisplayMonitors(
+      NULL, NULL, monitorEnumProc, reinterpret_cast<LPARAM>(&monitors));
+
+    // A display added or removed since the record may have shifted names
+    bool matches = monitors.size() == recordedDisplays.size();
+
+    for (auto monitor : monitors) {
+        if (!matches) {
+            break;
+        }
+
+        MONITORINFOEX monitorInfo;
+        monitorInfo.cbSize = sizeof(MONITORINFOEX);
+        GetMonitorInfo(monitor, &monitorInfo);
+
+        auto display = wanted.find(monitorInfo.szDevice);
+        if (display == wanted.end()) {
+            continue;
+        }
+
+        DWORD count = 0;
+        if (!GetNumberOfPhysicalMonitorsFromHMONITOR(monitor, &count)
+            || count == 0) {
+            matches = false;
+            break;
+        }
+
+        std::vector<PHYSICAL_MONITOR> physicalMonitors(count);
+        if (!GetPhysicalMonitorsFromHMONITOR(
+              monitor, count, physicalMonitors.data())) {
+            matches = false;
+            break;
+        }
+
+        std::vector<bool> used(count, false);
+        for (auto const& [ index, deviceId ] : display->second) {
+            if (index >= count) {
+                matches = false;
+                continue;
+            }
+
+            // Same display name and index, but possibly another monitor
+            DISPLAY_DEVICE displayDev;
+            displayDev.cb = sizeof(DISPLAY_DEVICE);
+            if (!EnumDisplayDevices(monitorInfo.szDevice,
+                                    static_cast<DWORD>(index),
+                                    &displayDev,
+                                    EDD_GET_DEVICE_INTERFACE_NAME)
+                || deviceId != displayDev.DeviceID) {
+                matches = false;
+                continue;
+            }
+
+            handles.insert(
+              { deviceId, physicalMonitors[index].hPhysicalMonitor });
+            used[index] = true;
+        }
+
+        for (DWORD i = 0; i < count; i++) {
+            if (!used[i]) {
+                DestroyPhysicalMonitor(physicalMonitors[i].hPhysicalMonitor);
+            }
+        }
+    }
+
+    if (!matches || handles.size() != wantedCount) {
+        populateHandlesMap();
+    }
+}
+
+
+
+Result<MonitorBrightness>
+tryGetMonitorBrightness(HANDLE hMonitor)
+{
+    auto reply = runBackendCall(hMonitor, [hMonitor] {
+        ValueReply reply;
+        reply.ok = GetMonitorBrightness(
+          hMonitor, &reply.minimum, &reply.current, &reply.maximum);
+        return reply;
+    });
+
+    if (!reply) {
+        return timedOut("monitor brightness request");
+    }
+
+    if (!reply->ok) {
+        return lastDdcError("failed to get monitor brightness");
+    }
+
+    MonitorBrightness brightness = {
+        static_cast<unsigned long>(reply->maximum),
+        static_cast<unsigned long>(reply->current)
+    };
+
+    return brightness;
+}
+
+Result<MonitorContrast>
+tryGetMonitorContrast(HANDLE hMonitor)
+{
+    auto reply = runBackendCall(hMonitor, [hMonitor] {
+        ValueReply reply;
+        reply.ok = GetMonitorContrast(
+          hMonitor, &reply.minimum, &reply.current, &reply.maximum);
+        return reply;
+    });
+
+    if (!reply) {
+        return timedOut("monitor contrast request");
+    }
+
+    if (!reply->ok) {
+        return lastDdcError("failed to get monitor contrast");
+    }
+
+    MonitorContrast contrast = { static_cast<unsigned long>(reply->maximum),
+                                 static_cast<unsigned long>(reply->current) };
+
+    return contrast;
+}
+
+Result<MonitorBrightness>
+trySetMonitorBrightness(HANDLE hMonitor, unsigned long level)
+{
+    auto brightness = tryGetMonitorBrightness(hMonitor);
+    if (!brightness) {
+        return brightness;
+    }
+
+    if (level > brightness->maximumBrightness) {
+        return DdcError{ DdcErrorCode::OutOfRange,
+                         "brightness level exceeds maximum" };
+    }
+
+    auto written = runBackendCall(hMonitor, [hMonitor, level] {
+        return SetMonitorBrightness(hMonitor, static_cast<DWORD>(level));
+    });
+
+    if (!written) {
+        return timedOut("monitor brightness write");
+    }
+
+    if (!*written) {
+        return lastDdcError("failed to set monitor brightness");
+    }
+
+    brightness->currentBrightness = level;
+    return brightness;
+}
+
+Result<MonitorContrast>
+trySetMonitorContrast(HANDLE hMonitor, unsigned long level)
+{
+    auto contrast = tryGetMonitorContrast(hMonitor);
+    if (!contrast) {
+        return contrast;
+    }
+
+    if (level > contrast->maximumContrast) {
+        return DdcError{ DdcErrorCode::OutOfRange,
+                         "contrast level exceeds maximum" };
+    }
+
+    auto written = runBackendCall(hMonitor, [hMonitor, level] {
+        return SetMonitorContrast(hMonitor, static_cast<DWORD>(level));
+    });
+
+    if (!written) {
+        return timedOut("monitor contrast write");
+    }
+
+    if (!*written) {
+        return lastDdcError("failed to set monitor contrast");
+    }
+
+    contrast->currentContrast = level;
+    return contrast;
+}
+
+Result<VcpFeature>
+tryGetVcpFeature(HANDLE hMonitor, uint8_t code)
+{
+    auto reply = runBackendCall(hMonitor, [hMonitor, code] {
+        ValueReply reply;
+        reply.ok = GetVCPFeatureAndVCPFeatureReply(
+          hMonitor, code, NULL, &reply.current, &reply.maximum);
+        return reply;
+    });
+
+    if (!reply) {
+        return timedOut("vcp feature request");
+    }
+
+    if (!reply->ok) {
+        return lastDdcError("failed to get vcp feature");
+    }
+
+    VcpFeature feature = { static_cast<unsigned long>(reply->maximum),
+                           static_cast<unsigned long>(reply->current) };
+
+    return feature;
+}
+
+Result<VcpFeature>
+trySetVcpFeature(HANDLE hMonitor, const VcpCode& code, unsigned long value)
+{
+    if (!code.isWritable()) {
+        return DdcError{ DdcErrorCode::Unsupported,
+                         "vcp feature is read-only" };
+    }
+
+    VcpFeature feature = { 0, value };
+
+    if (code.type == VcpType::Continuous) {
+        auto current = tryGetVcpFeature(hMonitor, code.code);
+        if (!current) {
+            return current;
+        }
+
+        feature.maximumValue = current->maximumValue;
+
+        if (value > feature.maximumValue) {
+            return DdcError{ DdcErrorCode::OutOfRange,
+                             "vcp value exceeds maximum" };
+        }
+    }
+
+    if (auto written = tryWriteVcpFeature(hMonitor, code.code, value);
+        !written) {
+        return written.error();
+    }
+
+    return feature;
+}
+
+Result<void>
+tryWriteVcpFeature(HANDLE hMonitor, uint8_t code, unsigned long value)
+{
+    auto written = runBackendCall(hMonitor, [hMonitor, code, value] {
+        return SetVCPFeature(hMonitor, code, static_cast<DWORD>(value));
+    });
+
+    if (!written) {
+        return timedOut("vcp feature write");
+    }
+
+    if (!*written) {
+        return lastDdcError("failed to set vcp feature");
+    }
+
+    return {};
+}
+
+MonitorBrightness
+getMonitorBrightness(HANDLE hMonitor)
+{
+    return tryGetMonitorBrightness(hMonitor).value();
+}
+
+MonitorContrast
+getMonitorContrast(HANDLE hMonitor)
+{
+    return tryGetMonitorContrast(hMonitor).value();
+}
+
+MonitorBrightness
+setMonitorBrightness(HANDLE hMonitor, unsigned long level)
+{
+    return trySetMonitorBrightness(hMonitor, level).value();
+}
+
+MonitorContrast
+setMonitorContrast(HANDLE hMonitor, unsigned long level)
+{
+    return trySetMonitorContrast(hMonitor, level).value();
+}
+
+VcpFeature
+getVcpFeature(HANDLE hMonitor, uint8_t code)
+{
+    return tryGetVcpFeature(hMonitor, code).value();
+}
+
+VcpFeature
+setVcpFeature(HANDLE hMonitor, const VcpCode& code, unsigned long value)
+{
+    return trySetVcpFeature(hMonitor, code, value).value();
+}
+
+void
+writeVcpFeature(HANDLE hMonitor, uint8_t code, unsigned long value)
+{
+    tryWriteVcpFeature(hMonitor, code, value).value();
+}
+
+VcpCode
+parseVcpCode(const std::string& feature)
+{
+    if (auto code = findVcpCode(std::string_view(feature))) {
+        return *code;
+    }
+
+    size_t end = 0;
+    unsigned long code = 0;
+    try {
+        code = std::stoul(feature, &end, 16);
+    } catch (const std::exception&) {
+        end = 0;
+    }
+
+    if (end != feature.size() || code > 0xff) {
+        throw std::runtime_error("unknown vcp feature: " + feature);
+    }
+
+    return vcpCodeFor(static_cast<uint8_t>(code));
+}
+
+VcpCode
+vcpCodeFor(uint8_t code)
+{
+    if (auto known = findVcpCode(code)) {
+        return *known;
+    }
+
+    return { code, "", VcpType::NonContinuous, VcpAccess::ReadWrite };
+}
+
+unsigned long
+parseVcpValue(const VcpCode& code, const std::string& value)
+{
+    if (auto named = findVcpValue(code, std::string_view(value))) {
+        return named->value;
+    }
+
+    size_t end = 0;
+    unsigned long parsed = 0;
+    try {
+        parsed = std::stoul(value, &end, 0);
+    } catch (const std::exception&) {
+        end = 0;
+    }
+
+    if (end != value.size() || parsed > 0xffff) {
+        throw std::runtime_error("invalid vcp value: " + value);
+    }
+
+    return parsed;
+}
+
+std::string
+formatVcpValue(const VcpCode& code, unsigned long value)
+{
+    if (auto named = findVcpValue(code, static_cast<uint16_t>(value))) {
+        return std::string(named->name);
+    }
+
+    return std::to_string(value);
+}
+
+
+Result<MonitorCapabilities>
+tryGetMonitorCapabilities(HANDLE hMonitor,
+                          const std::string& deviceId,
+                          bool useCache)
+{
+    if (useCache) {
+        if (auto cached = cachedMonitorCapabilities(deviceId)) {
+            return std::move(*cached);
+        }
+    }
+
+    struct CapabilitiesReply {
+        BOOL ok = FALSE;
+        std::string raw;
+    };
+
+    // Both requests run as one backend call, so the buffer is the call's own
+    auto reply = runBackendCall(hMonitor, [hMonitor] {
+        CapabilitiesReply reply;
+
+        DWORD length;
+        if (!GetCapabilitiesStringLength(hMonitor, &length)) {
+            return reply;
+        }
+
+        reply.raw.resize(length);
+        reply.ok = CapabilitiesRequestAndCapabilitiesReply(
+          hMonitor, reply.raw.data(), length);
+        return reply;
+    });
+
+    if (!reply) {
+        return timedOut("capabilities request");
+    }
+
+    if (!reply->ok) {
+        return lastDdcError("failed to get capabilities string");
+    }
+
+    auto raw = std::move(reply->raw);
+
+    // Reply length includes the terminating NUL
+    auto end = raw.find('\0');
+    if (end != std::string::npos) {
+        raw.resize(end);
+    }
+
+    MonitorCapabilities capabilities;
+    try {
+        capabilities = parseCapabilities(raw);
+    } catch (const std::runtime_error& e) {
+        return DdcError{ DdcErrorCode::InvalidReply, e.what() };
+    }
+
+    writeStateFile(capabilitiesCachePath(deviceId), raw);
+
+    return capabilities;
+}
+
+std::optional<MonitorCapabilities>
+cachedMonitorCapabilities(const std::string& deviceId)
+{
+    if (auto cached = readStateFile(capabilitiesCachePath(deviceId))) {
+        try {
+            return parseCapabilities(std::move(*cached));
+        } catch (const std::runtime_error&) {
+            // Corrupt cache entry, re-fetch
+        }
+    }
+
+    return std::nullopt;
+}
+
+MonitorCapabilities
+getMonitorCapabilities(HANDLE hMonitor,
+                       const std::string& deviceId,
+                       bool useCache)
+{
+    return tryGetMonitorCapabilities(hMonitor, deviceId, useCache).value();
+}
@@ -0,0 +1,175 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+#include "windows.h"
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+
+#include "capabilities.h"
+#include "result.h"
+#include "vcp.h"
+
+
+// Physical monitor handles, keyed by DeviceID
+extern std::map<std::string, HANDLE> handles;
+
+/**
+ * Enumerates every physical monitor. The DeviceID to display mapping found
+ * is recorded for populateHandlesMapFromTopology.
+ */
+void
+populateHandlesMap();
+
+/**
+ * Fast path for latency-sensitive commands: resolves monitors through the
+ * topology recorded by the last full enumeration, skipping the adapter scan,
+ * and only opens handles for `selected` when given. Each monitor opened is
+ * checked against its recorded DeviceID. Falls back to populateHandlesMap
+ * when nothing is recorded or the displays present no longer match.
+ */
+void
+populateHandlesMapFromTopology(const std::optional<std::string>& selected);
+
+/**
+ * Bounds every DDC/CI call. A call that overruns is abandoned on its own
+ * thread and reported as a timeout, and the monitor fails fast until that
+ * call returns; other processes' calls on that monitor wait for it. Unset
+ * (the default) runs calls inline with no bound.
+ */
+void
+setBackendTimeout(std::optional<std::chrono::milliseconds> timeout);
+
+
+struct MonitorBrightness {
+    unsigned long maximumBrightness;
+    unsigned long currentBrightness;
+};
+
+struct MonitorContrast {
+    unsigned long maximumContrast;
+    unsigned long currentContrast;
+};
+
+struct VcpFeature {
+    unsigned long maximumValue;
+    unsigned long currentValue;
+};
+
+/**
+ * The try* variants report failures as a DdcError instead of throwing, for
+ * loops over monitors where one failure shouldn't stop the rest. The plain
+ * variants throw std::runtime_error with the same message.
+ */
+
+Result<MonitorBrightness>
+tryGetMonitorBrightness(HANDLE hMonitor);
+
+Result<MonitorContrast>
+tryGetMonitorContrast(HANDLE hMonitor);
+
+Result<MonitorBrightness>
+trySetMonitorBrightness(HANDLE hMonitor, unsigned long level);
+
+Result<MonitorContrast>
+trySetMonitorContrast(HANDLE hMonitor, unsigned long level);
+
+Result<VcpFeature>
+tryGetVcpFeature(HANDLE hMonitor, uint8_t code);
+
+Result<VcpFeature>
+trySetVcpFeature(HANDLE hMonitor, const VcpCode& code, unsigned long value);
+
+Result<void>
+tryWriteVcpFeature(HANDLE hMonitor, uint8_t code, unsigned long value);
+
+Result<MonitorCapabilities>
+tryGetMonitorCapabilities(HANDLE hMonitor,
+                          const std::string& deviceId,
+                          bool useCache = true);
+
+// Capabilities from the on-disk cache alone, without touching the monitor
+std::optional<MonitorCapabilities>
+cachedMonitorCapabilities(const std::string& deviceId);
+
+MonitorBrightness
+getMonitorBrightness(HANDLE hMonitor);
+
+MonitorContrast
+getMonitorContrast(HANDLE hMonitor);
+
+// Setters return the monitor's state after the write
+
+MonitorBrightness
+setMonitorBrightness(HANDLE hMonitor, unsigned long level);
+
+MonitorContrast
+setMonitorContrast(HANDLE hMonitor, unsigned long level);
+
+VcpFeature
+getVcpFeature(HANDLE hMonitor, uint8_t code);
+
+// The returned maximum is 0 unless the code is continuous
+VcpFeature
+setVcpFeature(HANDLE hMonitor, const VcpCode& code, unsigned long value);
+
+// Raw write without access or range checks
+void
+writeVcpFeature(HANDLE hMonitor, uint8_t code, unsigned long value);
+
+/**
+ * Resolves a VCP feature given by name ("brightness") or hex code ("0x10",
+ * "10"). Unknown hex codes are treated as read-write non-continuous.
+ */
+VcpCode
+parseVcpCode(const std::string& feature);
+
+// The known feature for `code`, or a read-write non-continuous one
+VcpCode
+vcpCodeFor(uint8_t code);
+
+/**
+ * Parses a value for a feature, either numerically or by one of its known
+ * value names ("hdmi1" for input).
+ */
+unsigned long
+parseVcpValue(const VcpCode& code, const std::string& value);
+
+std::string
+formatVcpValue(const VcpCode& code, unsigned long value);
+
+/**
+ * Fetches the MCCS capabilities string. This is a multi-fragment DDC read
+ * and can take seconds, so results are cached on disk per DeviceID and a
+ * cache hit costs a single file read.
+ */
+MonitorCapabilities
+getMonitorCapabilities(HANDLE hMonitor,
+                       const std::string& deviceId,
+                       bool useCache = true);
@@ -0,0 +1,107 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "output_buffer.h"
+
+#include <algorithm>
+
+
+OutputBuffer::OutputBuffer(std::ostream& stream, size_t capacity)
+  : stream(stream)
+  , target(stream.rdbuf())
+  , chunk((std::max)(capacity, size_t(1)))
+{
+    setp(chunk.data(), chunk.data() + chunk.size());
+    stream.rdbuf(this);
+}
+
+OutputBuffer::~OutputBuffer()
+{
+    drain();
+    target->pubsync();
+    stream.rdbuf(target);
+}
+
+bool
+OutputBuffer::drain()
+{
+    std::streamsize pending = pptr() - pbase();
+    if (pending == 0) {
+        return true;
+    }
+
+    bool written = target->sputn(pbase(), pending) == pending;
+    setp(chunk.data(), chunk.data() + chunk.size());
+    return written;
+}
+
+OutputBuffer::int_type
+OutputBuffer::overflow(int_type ch)
+{
+    if (!drain()) {
+        return traits_type::eof();
+    }
+
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(ch);
+        pbump(1);
+    }
+
+    return traits_type::not_eof(ch);
+}
+
+std::streamsize
+OutputBuffer::xsputn(const char* data, std::streamsize count)
+{
+    std::streamsize free = epptr() - pptr();
+    if (count <= free) {
+        std::copy(data, data + count, pptr());
+        pbump(static_cast<int>(count));
+        return count;
+    }
+
+    // Too big for what's left: send what's buffered, then either buffer the
+    // rest or, if it would fill a whole chunk anyway, pass it straight on
+    if (!drain()) {
+        return 0;
+    }
+
+    if (count >= static_cast<std::streamsize>(chunk.size())) {
+        return target->sputn(data, count);
+    }
+
+    std::copy(data, data + count, pptr());
+    pbump(static_cast<int>(count));
+    return count;
+}
+
+int
+OutputBuffer::sync()
+{
+    if (!drain()) {
+        return -1;
+    }
+
+    return target->pubsync();
+}
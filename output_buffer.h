@@ -0,0 +1,65 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <streambuf>
+#include <vector>
+
+
+/**
+ * Output buffer installed on a stream for its lifetime. Text is collected in
+ * a fixed-size chunk and handed to the stream's original buffer in one write
+ * when the chunk fills up or the stream is flushed, rather than on every
+ * line. Anything still buffered is written out on destruction.
+ *
+ * Not thread-safe, like the stream it replaces; callers writing from several
+ * threads serialise access.
+ */
+class OutputBuffer : public std::streambuf {
+public:
+    static constexpr size_t defaultCapacity = 64 * 1024;
+
+    explicit OutputBuffer(std::ostream& stream,
+                          size_t capacity = defaultCapacity);
+    ~OutputBuffer() override;
+
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+protected:
+    int_type overflow(int_type ch) override;
+    std::streamsize xsputn(const char* data, std::streamsize count) override;
+    int sync() override;
+
+private:
+    // Hands the buffered bytes to the original buffer
+    bool drain();
+
+    std::ostream& stream;
+    std::streambuf* target;
+    std::vector<char> chunk;
+};
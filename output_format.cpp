@@ -0,0 +1,102 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "output_format.h"
+
+#include <fcntl.h>
+#include <io.h>
+
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+using json = nlohmann::json;
+
+
+namespace {
+
+std::vector<uint8_t>
+encode(const json& document, OutputFormat format)
+{
+    return format == OutputFormat::Cbor ? json::to_cbor(document)
+                                        : json::to_msgpack(document);
+}
+
+} // namespace
+
+
+OutputFormat
+parseOutputFormat(const std::string& name)
+{
+    if (name == "json") {
+        return OutputFormat::Json;
+    }
+    if (name == "cbor") {
+        return OutputFormat::Cbor;
+    }
+    if (name == "msgpack") {
+        return OutputFormat::MsgPack;
+    }
+
+    throw std::runtime_error("unknown output format: " + name);
+}
+
+void
+prepareOutputStream(FILE* stream, OutputFormat format)
+{
+    if (isBinaryFormat(format)) {
+        _setmode(_fileno(stream), _O_BINARY);
+    }
+}
+
+void
+writeDocument(std::ostream& out, const json& document, OutputFormat format)
+{
+    if (!isBinaryFormat(format)) {
+        out << document << '\n';
+        return;
+    }
+
+    auto bytes = encode(document, format);
+    out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+
+void
+writeFrame(std::ostream& out, const json& message, OutputFormat format)
+{
+    if (!isBinaryFormat(format)) {
+        out << message << '\n';
+        return;
+    }
+
+    auto bytes = encode(message, format);
+    auto length = static_cast<uint32_t>(bytes.size());
+
+    const char prefix[] = { static_cast<char>(length >> 24),
+                            static_cast<char>(length >> 16),
+                            static_cast<char>(length >> 8),
+                            static_cast<char>(length) };
+    out.write(prefix, sizeof(prefix));
+    out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
@@ -0,0 +1,73 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <cstdio>
+#include <ostream>
+#include <string>
+
+#include <json.hpp>
+
+
+enum class OutputFormat {
+    Json,
+    Cbor,
+    MsgPack
+};
+
+OutputFormat
+parseOutputFormat(const std::string& name);
+
+inline bool
+isBinaryFormat(OutputFormat format)
+{
+    return format == OutputFormat::Cbor || format == OutputFormat::MsgPack;
+}
+
+/**
+ * Stops the C runtime from translating line endings on `stream`, which would
+ * corrupt binary output. Does nothing for text formats.
+ */
+void
+prepareOutputStream(FILE* stream, OutputFormat format);
+
+/**
+ * Writes a whole document: compact JSON plus a newline, or the encoded bytes
+ * as they are for binary formats (CBOR and MessagePack are self-delimiting).
+ */
+void
+writeDocument(std::ostream& out,
+              const nlohmann::json& document,
+              OutputFormat format);
+
+/**
+ * Writes one message of a stream. Text formats put one document per line.
+ * Binary formats prefix each message with its length as a 4-byte
+ * big-endian integer, so readers can split the stream without decoding it.
+ */
+void
+writeFrame(std::ostream& out,
+           const nlohmann::json& message,
+           OutputFormat format);
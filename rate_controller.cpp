@@ -0,0 +1,81 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "rate_controller.h"
+
+#include <algorithm>
+#include <map>
+
+#include "retry.h"
+
+
+BusRateController::Clock::time_point
+BusRateController::nextSlot() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return lastCompletion
+           + std::chrono::duration_cast<Clock::duration>(
+             std::chrono::duration<double>(1.0 / commandsPerSecond));
+}
+
+void
+BusRateController::recordSuccess()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    commandsPerSecond =
+      (std::min)(commandsPerSecond + additiveIncrease, maximumRate);
+    lastCompletion = Clock::now();
+}
+
+void
+BusRateController::recordFailure(DdcErrorCode code)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (isRetryable(code)) {
+        commandsPerSecond =
+          (std::max)(commandsPerSecond * multiplicativeDecrease, minimumRate);
+    }
+
+    lastCompletion = Clock::now();
+}
+
+double
+BusRateController::rate() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return commandsPerSecond;
+}
+
+BusRateController&
+busRateController(const std::string& deviceId)
+{
+    static std::mutex registryMutex;
+    static std::map<std::string, BusRateController> controllers;
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    return controllers[deviceId];
+}
@@ -0,0 +1,108 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "result.h"
+
+
+// Minimum spacing between DDC/CI transactions on one monitor
+inline constexpr std::chrono::milliseconds ddcInterMessageDelay{ 50 };
+
+/**
+ * AIMD pacing for one monitor's bus. The allowed command rate starts at the
+ * DDC/CI maximum, grows additively with each successful transaction and is
+ * halved on each transient failure, so a monitor that starts NAKing under
+ * load is given room to recover instead of being hammered with retries.
+ *
+ * Spacing is measured from the end of one transaction to the start of the
+ * next. Thread-safe.
+ */
+class BusRateController {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Earliest time the next transaction may start
+    Clock::time_point nextSlot() const;
+
+    void recordSuccess();
+    // Only transient errors are taken as congestion
+    void recordFailure(DdcErrorCode code);
+
+    // Commands per second
+    double rate() const;
+
+private:
+    mutable std::mutex mutex;
+    double commandsPerSecond = maximumRate;
+    Clock::time_point lastCompletion;
+
+    static constexpr double maximumRate = 1000.0 / ddcInterMessageDelay.count();
+    static constexpr double minimumRate = 4.0;
+    static constexpr double additiveIncrease = 1.0;
+    static constexpr double multiplicativeDecrease = 0.5;
+};
+
+// Shared by everything in this process talking to the same monitor
+BusRateController&
+busRateController(const std::string& deviceId);
+
+template<typename T>
+void
+recordOutcome(BusRateController& controller, const Result<T>& result)
+{
+    if (result) {
+        controller.recordSuccess();
+    } else {
+        controller.recordFailure(result.error().code);
+    }
+}
+
+template<typename T>
+void
+recordOutcome(BusRateController& controller, const T&)
+{
+    controller.recordSuccess();
+}
+
+/**
+ * Waits for the bus's next slot, then runs fn (which returns a Result) and
+ * feeds its outcome back into the controller.
+ */
+template<typename Fn>
+auto
+pacedTransaction(BusRateController& controller, Fn&& fn) -> decltype(fn())
+{
+    std::this_thread::sleep_until(controller.nextSlot());
+
+    auto result = fn();
+    recordOutcome(controller, result);
+
+    return result;
+}
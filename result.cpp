@@ -0,0 +1,92 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "result.h"
+
+#include "windows.h"
+
+
+std::string_view
+to_string(DdcErrorCode code)
+{
+    switch (code) {
+        case DdcErrorCode::Nak:
+            return "nak";
+        case DdcErrorCode::Checksum:
+            return "checksum";
+        case DdcErrorCode::InvalidReply:
+            return "invalid-reply";
+        case DdcErrorCode::Timeout:
+            return "timeout";
+        case DdcErrorCode::Unsupported:
+            return "unsupported";
+        case DdcErrorCode::OutOfRange:
+            return "out-of-range";
+        case DdcErrorCode::Disconnected:
+            return "disconnected";
+        case DdcErrorCode::Failed:
+            break;
+    }
+
+    return "failed";
+}
+
+DdcError
+lastDdcError(std::string message)
+{
+    // The graphics error codes are HRESULT-typed in winerror.h
+    switch (GetLastError()) {
+        case static_cast<DWORD>(ERROR_GRAPHICS_I2C_ERROR_TRANSMITTING_DATA):
+            return { DdcErrorCode::Nak, std::move(message) };
+
+        case static_cast<DWORD>(ERROR_GRAPHICS_DDCCI_INVALID_MESSAGE_CHECKSUM):
+            return { DdcErrorCode::Checksum, std::move(message) };
+
+        case static_cast<DWORD>(ERROR_GRAPHICS_DDCCI_INVALID_DATA):
+        case static_cast<DWORD>(ERROR_GRAPHICS_DDCCI_INVALID_MESSAGE_COMMAND):
+        case static_cast<DWORD>(ERROR_GRAPHICS_DDCCI_INVALID_MESSAGE_LENGTH):
+        case static_cast<DWORD>(
+          ERROR_GRAPHICS_DDCCI_MONITOR_RETURNED_INVALID_TIMING_STATUS_BYTE):
+        case static_cast<DWORD>(ERROR_GRAPHICS_MCA_INVALID_CAPABILITIES_STRING):
+            return { DdcErrorCode::InvalidReply, std::move(message) };
+
+        case static_cast<DWORD>(ERROR_GRAPHICS_I2C_ERROR_RECEIVING_DATA):
+        case ERROR_TIMEOUT:
+        case ERROR_SEM_TIMEOUT:
+            return { DdcErrorCode::Timeout, std::move(message) };
+
+        case static_cast<DWORD>(ERROR_GRAPHICS_DDCCI_VCP_NOT_SUPPORTED):
+        case static_cast<DWORD>(ERROR_GRAPHICS_I2C_NOT_SUPPORTED):
+        case ERROR_NOT_SUPPORTED:
+            return { DdcErrorCode::Unsupported, std::move(message) };
+
+        case static_cast<DWORD>(ERROR_GRAPHICS_I2C_DEVICE_DOES_NOT_EXIST):
+        case static_cast<DWORD>(ERROR_GRAPHICS_MONITOR_NO_LONGER_EXISTS):
+        case static_cast<DWORD>(ERROR_GRAPHICS_INVALID_PHYSICAL_MONITOR_HANDLE):
+        case ERROR_INVALID_HANDLE:
+            return { DdcErrorCode::Disconnected, std::move(message) };
+    }
+
+    return { DdcErrorCode::Failed, std::move(message) };
+}
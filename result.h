@@ -0,0 +1,141 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+
+
+enum class DdcErrorCode {
+    // Monitor didn't acknowledge the message
+    Nak,
+    Checksum,
+    // Malformed or unexpected reply
+    InvalidReply,
+    Timeout,
+    Unsupported,
+    OutOfRange,
+    Disconnected,
+    Failed
+};
+
+struct DdcError {
+    DdcErrorCode code;
+    std::string message;
+};
+
+// Stable name for reports, e.g. "out-of-range"
+std::string_view
+to_string(DdcErrorCode code);
+
+/**
+ * Classifies GetLastError() after a failed monitor configuration call.
+ */
+DdcError
+lastDdcError(std::string message);
+
+
+/**
+ * Either a value or a DdcError, for paths where a failure is an expected
+ * per-monitor outcome rather than a reason to unwind.
+ *
+ * value() on an error throws std::runtime_error with the error's message, so
+ * callers that want the exception behaviour can still have it.
+ */
+template<typename T>
+class Result {
+public:
+    Result(T value)
+      : state(std::in_place_index<0>, std::move(value))
+    {}
+    Result(DdcError error)
+      : state(std::in_place_index<1>, std::move(error))
+    {}
+
+    bool hasValue() const { return state.index() == 0; }
+    explicit operator bool() const { return hasValue(); }
+
+    T& value() &
+    {
+        throwIfError();
+        return std::get<0>(state);
+    }
+    const T& value() const&
+    {
+        throwIfError();
+        return std::get<0>(state);
+    }
+    T&& value() &&
+    {
+        throwIfError();
+        return std::get<0>(std::move(state));
+    }
+
+    T& operator*() { return std::get<0>(state); }
+    const T& operator*() const { return std::get<0>(state); }
+    T* operator->() { return &std::get<0>(state); }
+    const T* operator->() const { return &std::get<0>(state); }
+
+    const DdcError& error() const { return std::get<1>(state); }
+
+private:
+    void throwIfError() const
+    {
+        if (!hasValue()) {
+            throw std::runtime_error(error().message);
+        }
+    }
+
+    std::variant<T, DdcError> state;
+};
+
+template<>
+class Result<void> {
+public:
+    Result() = default;
+    Result(DdcError error)
+      : failure(std::move(error))
+      , failed(true)
+    {}
+
+    bool hasValue() const { return !failed; }
+    explicit operator bool() const { return hasValue(); }
+
+    void value() const
+    {
+        if (failed) {
+            throw std::runtime_error(failure.message);
+        }
+    }
+
+    const DdcError& error() const { return failure; }
+
+private:
+    DdcError failure = {};
+    bool failed = false;
+};
@@ -0,0 +1,108 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "retry.h"
+
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+
+
+RetryPolicies
+parseRetryPolicies(const std::string& spec, RetryPolicies policies)
+{
+    size_t start = 0;
+    while (start < spec.size()) {
+        auto end = spec.find(',', start);
+        if (end == std::string::npos) {
+            end = spec.size();
+        }
+
+        auto entry = spec.substr(start, end - start);
+        start = end + 1;
+
+        auto separator = entry.find('=');
+        if (separator == std::string::npos) {
+            throw std::runtime_error("expected <operation>=<attempts>: "
+                                     + entry);
+        }
+
+        auto name = entry.substr(0, separator);
+        RetryPolicy* policy = nullptr;
+        if (name == "read") {
+            policy = &policies.read;
+        } else if (name == "write") {
+            policy = &policies.write;
+        } else if (name == "capabilities") {
+            policy = &policies.capabilities;
+        } else {
+            throw std::runtime_error("unknown operation: " + name);
+        }
+
+        size_t parsed = 0;
+        unsigned long attempts = 0;
+        try {
+            attempts = std::stoul(entry.substr(separator + 1), &parsed);
+        } catch (const std::exception&) {
+            parsed = 0;
+        }
+
+        if (parsed == 0 || parsed != entry.size() - separator - 1
+            || attempts == 0) {
+            throw std::runtime_error("invalid attempt count: " + entry);
+        }
+
+        policy->maxAttempts = static_cast<unsigned>(attempts);
+    }
+
+    return policies;
+}
+
+bool
+isRetryable(DdcErrorCode code)
+{
+    switch (code) {
+        case DdcErrorCode::Unsupported:
+        case DdcErrorCode::OutOfRange:
+        case DdcErrorCode::Disconnected:
+            return false;
+        default:
+            return true;
+    }
+}
+
+std::chrono::milliseconds
+retryBackoff(const RetryPolicy& policy, unsigned retry)
+{
+    thread_local std::minstd_rand random{ std::random_device{}() };
+
+    auto window = policy.initialBackoff.count();
+    for (unsigned i = 1; i < retry && window < policy.maxBackoff.count(); i++) {
+        window *= 2;
+    }
+    window = (std::min)(window, policy.maxBackoff.count());
+
+    std::uniform_int_distribution<long long> jitter(0, window / 2);
+    return std::chrono::milliseconds(window - window / 2 + jitter(random));
+}
@@ -0,0 +1,116 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "result.h"
+
+
+struct RetryPolicy {
+    // Including the first attempt
+    unsigned maxAttempts;
+    std::chrono::milliseconds initialBackoff;
+    std::chrono::milliseconds maxBackoff;
+    // No retry is started that would end past this, measured from the first
+    // attempt
+    std::chrono::milliseconds deadline;
+};
+
+struct RetryPolicies {
+    RetryPolicy read;
+    RetryPolicy write;
+    RetryPolicy capabilities;
+};
+
+/**
+ * DDC/CI wants ~50ms between messages, so backoff starts there. Capabilities
+ * reads are multi-fragment and slow, so they get fewer, longer-spaced tries.
+ */
+inline constexpr RetryPolicies defaultRetryPolicies = {
+    { 4,
+      std::chrono::milliseconds(50),
+      std::chrono::milliseconds(400),
+      std::chrono::milliseconds(2000) },
+    { 3,
+      std::chrono::milliseconds(50),
+      std::chrono::milliseconds(400),
+      std::chrono::milliseconds(2000) },
+    { 3,
+      std::chrono::milliseconds(200),
+      std::chrono::milliseconds(1000),
+      std::chrono::milliseconds(15000) },
+};
+
+/**
+ * Parses overrides such as "read=5,write=2,capabilities=1" (attempts per
+ * operation class) on top of the given policies.
+ */
+RetryPolicies
+parseRetryPolicies(const std::string& spec,
+                   RetryPolicies policies = defaultRetryPolicies);
+
+// Transient bus errors are worth retrying; unsupported or out-of-range ones
+// will fail the same way again
+bool
+isRetryable(DdcErrorCode code);
+
+/**
+ * Delay before the given retry (1-based): exponential, capped, with the upper
+ * half jittered so monitors sharing a failure don't retry in lockstep.
+ */
+std::chrono::milliseconds
+retryBackoff(const RetryPolicy& policy, unsigned retry);
+
+/**
+ * Runs fn, which returns a Result, until it succeeds, fails permanently or
+ * the policy is exhausted. Backoff sleeps on the calling thread, which for
+ * executor jobs only holds up the monitor being retried.
+ */
+template<typename Fn>
+auto
+retryTransaction(const RetryPolicy& policy, Fn&& fn, unsigned& retries)
+  -> decltype(fn())
+{
+    auto deadline = std::chrono::steady_clock::now() + policy.deadline;
+
+    for (unsigned attempt = 1;; attempt++) {
+        auto result = fn();
+        if (result || attempt >= policy.maxAttempts
+            || !isRetryable(result.error().code)) {
+            return result;
+        }
+
+        auto delay = retryBackoff(policy, attempt);
+        if (std::chrono::steady_clock::now() + delay > deadline) {
+            return result;
+        }
+
+        std::this_thread::sleep_for(delay);
+        retries++;
+    }
+}
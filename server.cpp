@@ -0,0 +1,493 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "server.h"
+
+#include "windows.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <map>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bus_lock.h"
+#include "monitor.h"
+#include "rate_controller.h"
+#include "retry.h"
+#include "spsc_queue.h"
+
+#include <json.hpp>
+
+using json = nlohmann::json;
+
+
+namespace {
+
+constexpr size_t queueCapacity = 256;
+
+/**
+ * Auto-reset event used to wake an idle consumer. Producers never wait on it.
+ */
+class WakeEvent {
+public:
+    WakeEvent() : handle(CreateEventA(NULL, FALSE, FALSE, NULL))
+    {
+        if (handle == NULL) {
+            throw std::runtime_error("failed to create event");
+        }
+    }
+
+    ~WakeEvent() { CloseHandle(handle); }
+
+    WakeEvent(const WakeEvent&) = delete;
+    WakeEvent& operator=(const WakeEvent&) = delete;
+
+    void notify() { SetEvent(handle); }
+    void wait() { WaitForSingleObject(handle, INFINITE); }
+
+private:
+    HANDLE handle;
+};
+
+struct MonitorCommand {
+    json id;
+    VcpCode code = {};
+    bool isSet = false;
+    unsigned long value = 0;
+};
+
+struct MonitorResult {
+    json id;
+    std::string monitor;
+    VcpCode code = {};
+    bool isSet = false;
+    VcpFeature value = {};
+    std::string error;
+    // Unset for malformed requests
+    std::optional<DdcErrorCode> errorCode;
+    std::chrono::milliseconds lockWait{ 0 };
+    unsigned retries = 0;
+};
+
+using ResultQueue = SpscQueue<MonitorResult, queueCapacity>;
+
+void
+pushResult(ResultQueue& results, WakeEvent& wake, MonitorResult result)
+{
+    while (!results.tryPush(std::move(result))) {
+        wake.notify();
+        std::this_thread::yield();
+    }
+
+    wake.notify();
+}
+
+/**
+ * Owns one physical monitor. Commands arrive on an SPSC ring from the reader
+ * thread and results leave on another to the writer thread.
+ */
+class MonitorWorker {
+public:
+    MonitorWorker(std::string id,
+                  HANDLE handle,
+                  const RetryPolicies& retryPolicies,
+                  ValueStore* store,
+                  WakeEvent& writerWake)
+      : id(std::move(id))
+      , handle(handle)
+      , retryPolicies(retryPolicies)
+      , store(store)
+      , busLock(this->id)
+      , rateController(busRateController(this->id))
+      , writerWake(writerWake)
+      , thread(&MonitorWorker::run, this)
+    {}
+
+    ~MonitorWorker()
+    {
+        stop();
+        thread.join();
+    }
+
+    // Reader thread only
+    bool trySubmit(MonitorCommand command)
+    {
+        if (!commands.tryPush(std::move(command))) {
+            return false;
+        }
+
+        wake.notify();
+        return true;
+    }
+
+    void stop()
+    {
+        stopping.store(true, std::memory_order_release);
+        wake.notify();
+    }
+
+    bool isFinished() const { return finished.load(std::memory_order_acquire); }
+
+    ResultQueue results;
+
+private:
+    void run()
+    {
+        for (;;) {
+            drainCommands();
+
+            if (pending.empty()) {
+                if (stopping.load(std::memory_order_acquire)
+                    && commands.empty()) {
+                    break;
+                }
+
+                wake.wait();
+                continue;
+            }
+
+            auto command = std::move(pending.front());
+            pending.pop_front();
+
+            auto result = execute(command);
+            if (store && result.error.empty()) {
+                recordValue(result);
+            }
+
+            pushResult(results, writerWake, result);
+
+            if (!command.isSet) {
+                shareRead(result);
+            }
+        }
+
+        finished.store(true, std::memory_order_release);
+        writerWake.notify();
+    }
+
+    void drainCommands()
+    {
+        while (auto command = commands.tryPop()) {
+            pending.push_back(std::move(*command));
+        }
+    }
+
+    /**
+     * Single-flight reads: every queued read of the same code, including
+     * those that arrived while the transaction was in flight, gets this
+     * result instead of a bus round trip of its own. Stops at the next
+     * write to that code so reads never observe stale values.
+     */
+    void shareRead(const MonitorResult& result)
+    {
+        drainCommands();
+
+        for (auto it = pending.begin(); it != pending.end();) {
+            if (it->code.code != result.code.code) {
+                ++it;
+                continue;
+            }
+
+            if (it->isSet) {
+                break;
+            }
+
+            auto shared = result;
+            shared.id = std::move(it->id);
+            shared.lockWait = std::chrono::milliseconds(0);
+            shared.retries = 0;
+            pushResult(results, writerWake, std::move(shared));
+
+            it = pending.erase(it);
+        }
+    }
+
+    /**
+     * Keeps the value store current, so --max-age reads in other processes
+     * never serve a value replaced through the server. Writes are saved
+     * before they are answered; reads go out with the next save.
+     */
+    void recordValue(const MonitorResult& result)
+    {
+        store->put(id, result.code.code, result.value);
+        if (!result.isSet) {
+            return;
+        }
+
+        try {
+            store->save();
+        } catch (const std::runtime_error&) {
+            // Still recorded, so the next save or the one on exit retries
+        }
+    }
+
+    MonitorResult execute(const MonitorCommand& command)
+    {
+        MonitorResult result;
+        result.id = command.id;
+        result.monitor = id;
+        result.code = command.code;
+        result.isSet = command.isSet;
+
+        try {
+            // Per transaction, so other processes can interleave between
+            // queued commands
+            ScopedBusLock lock(busLock);
+            result.lockWait = lock.waited;
+
+            auto value = retryTransaction(
+              command.isSet ? retryPolicies.write : retryPolicies.read,
+              [&] {
+                  return pacedTransaction(rateController, [&] {
+                      return command.isSet
+                               ? trySetVcpFeature(
+                                   handle, command.code, command.value)
+                               : tryGetVcpFeature(handle, command.code.code);
+                  });
+              },
+              result.retries);
+
+            if (value) {
+                result.value = *value;
+            } else {
+                result.error = value.error().message;
+                result.errorCode = value.error().code;
+            }
+        } catch (const std::runtime_error& e) {
+            result.error = e.what();
+        }
+
+        return result;
+    }
+
+    std::string id;
+    HANDLE handle;
+    const RetryPolicies retryPolicies;
+    ValueStore* store;
+    BusLock busLock;
+    BusRateController& rateController;
+    WakeEvent& writerWake;
+
+    SpscQueue<MonitorCommand, queueCapacity> commands;
+    WakeEvent wake;
+
+    // Commands taken off the ring but not yet executed; worker thread only
+    std::deque<MonitorCommand> pending;
+    std::atomic<bool> stopping{ false };
+    std::atomic<bool> finished{ false };
+
+    // Last, so everything above is initialised before the thread starts
+    std::thread thread;
+};
+
+json
+formatResult(const MonitorResult& result)
+{
+    json response = { { "id", result.id } };
+
+    if (!result.monitor.empty()) {
+        response["monitor"] = result.monitor;
+    }
+
+    if (result.lockWait.count() > 0) {
+        response["lockWaitMs"] = result.lockWait.count();
+    }
+
+    if (result.retries > 0) {
+        response["retries"] = result.retries;
+    }
+
+    if (!result.error.empty()) {
+        response["error"] = result.error;
+        if (result.errorCode) {
+            response["errorCode"] = std::string(to_string(*result.errorCode));
+        }
+        return response;
+    }
+
+    response["vcp"] = result.code.name.empty()
+                        ? json(result.code.code)
+                        : json(std::string(result.code.name));
+    response["value"] = result.value.currentValue;
+
+    if (!result.isSet) {
+        response["maximum"] = result.value.maximumValue;
+    }
+
+    return response;
+}
+
+MonitorCommand
+parseCommand(const json& request)
+{
+    MonitorCommand command;
+
+    // Numbers are codes as formatResult writes them, not hex strings
+    const auto& feature = request.at("vcp");
+    if (feature.is_number()) {
+        if (!feature.is_number_unsigned() || feature.get<uint64_t>() > 0xff) {
+            throw std::runtime_error("vcp code out of range");
+        }
+
+        command.code = vcpCodeFor(feature.get<uint8_t>());
+    } else {
+        command.code = parseVcpCode(feature.get<std::string>());
+    }
+
+    if (request.count("value")) {
+        const auto& value = request["value"];
+        command.isSet = true;
+
+        if (value.is_number()) {
+            if (!value.is_number_unsigned()
+                || value.get<uint64_t>() > 0xffff) {
+                throw std::runtime_error("vcp value out of range");
+            }
+
+            command.value = value.get<unsigned long>();
+        } else {
+            command.value =
+              parseVcpValue(command.code, value.get<std::string>());
+        }
+    } else if (!command.code.isReadable()) {
+        throw std::runtime_error("vcp feature is write-only");
+    }
+
+    return command;
+}
+
+} // namespace
+
+
+int
+runServer(std::istream& in,
+          std::ostream& out,
+          OutputFormat format,
+          const RetryPolicies& retryPolicies,
+          ValueStore* store)
+{
+    WakeEvent writerWake;
+
+    std::map<std::string, std::unique_ptr<MonitorWorker>> workers;
+    for (auto const& [ id, handle ] : handles) {
+        workers.emplace(
+          id,
+          std::make_unique<MonitorWorker>(
+            id, handle, retryPolicies, store, writerWake));
+    }
+
+    // Errors detected by the reader skip the workers entirely
+    ResultQueue readerResults;
+    std::atomic<bool> readerFinished{ false };
+
+    std::thread writer([&] {
+        for (;;) {
+            bool wrote = false;
+
+            auto drain = [&](ResultQueue& results) {
+                while (auto result = results.tryPop()) {
+                    writeFrame(out, formatResult(*result), format);
+                    wrote = true;
+                }
+            };
+
+            drain(readerResults);
+
+            bool allFinished = readerFinished.load(std::memory_order_acquire);
+            for (auto& [ id, worker ] : workers) {
+                // Check before draining so no result can be missed
+                allFinished = worker->isFinished() && allFinished;
+                drain(worker->results);
+            }
+
+            if (wrote) {
+                out.flush();
+            } else if (allFinished) {
+                break;
+            } else {
+                writerWake.wait();
+            }
+        }
+    });
+
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.find_first_not_of(" \t\r") == std::string::npos) {
+            continue;
+        }
+
+        json request;
+        MonitorCommand command;
+        MonitorWorker* worker = nullptr;
+
+        try {
+            request = json::parse(line);
+            command = parseCommand(request);
+            command.id = request.count("id") ? request["id"] : json();
+
+            auto it = workers.find(request.at("monitor").get<std::string>());
+            if (it == workers.end()) {
+                throw std::runtime_error("monitor not found");
+            }
+
+            worker = it->second.get();
+        } catch (const std::exception& e) {
+            MonitorResult result;
+            result.id = request.is_object() && request.count("id")
+                          ? request["id"]
+                          : json();
+            result.error = e.what();
+
+            pushResult(readerResults, writerWake, std::move(result));
+            continue;
+        }
+
+        // Only blocks when a monitor is a full ring behind
+        while (!worker->trySubmit(command)) {
+            std::this_thread::yield();
+        }
+    }
+
+    for (auto& [ id, worker ] : workers) {
+        worker->stop();
+    }
+
+    readerFinished.store(true, std::memory_order_release);
+    writerWake.notify();
+    writer.join();
+
+    if (store) {
+        store->save();
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,58 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <iostream>
+
+#include "output_format.h"
+#include "retry.h"
+#include "value_store.h"
+
+
+/**
+ * Long-running mode. Reads one JSON request per line from `in` and writes
+ * one JSON response per line to `out`:
+ *
+ *   {"id": 1, "monitor": "<id>", "vcp": "brightness"}
+ *   {"id": 2, "monitor": "<id>", "vcp": "brightness", "value": 40}
+ *
+ * Each monitor in `handles` is owned by a dedicated worker thread fed through
+ * a lock-free SPSC ring, so a slow monitor never holds up requests for
+ * another and the reader thread never blocks on a DDC transaction. Identical
+ * reads queued against one monitor share a single transaction. Responses are
+ * written in completion order and carry the request id.
+ *
+ * With a binary `format`, each response is a length-prefixed CBOR or
+ * MessagePack frame instead of a line; requests are always JSON lines.
+ * Transactions are retried per `retryPolicies`, as for one-shot commands.
+ * Values read and written are recorded in `store` when given, each write
+ * saved before it is answered.
+ */
+int
+runServer(std::istream& in,
+          std::ostream& out,
+          OutputFormat format = OutputFormat::Json,
+          const RetryPolicies& retryPolicies = defaultRetryPolicies,
+          ValueStore* store = nullptr);
@@ -0,0 +1,152 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "snapshot.h"
+
+#include <stdexcept>
+
+#include "vcp.h"
+
+
+namespace {
+
+constexpr std::string_view magic = "DDCS";
+constexpr uint8_t version = 1;
+
+void
+putInteger(std::string& out, uint64_t value, size_t bytes)
+{
+    for (size_t i = 0; i < bytes; i++) {
+        out.push_back(static_cast<char>(value >> (8 * i) & 0xff));
+    }
+}
+
+class Reader {
+public:
+    explicit Reader(std::string_view data) : data(data) {}
+
+    uint64_t integer(size_t bytes)
+    {
+        if (data.size() - position < bytes) {
+            throw std::runtime_error("snapshot is truncated");
+        }
+
+        uint64_t value = 0;
+        for (size_t i = 0; i < bytes; i++) {
+            auto byte = static_cast<uint8_t>(data[position++]);
+            value |= uint64_t(byte) << (8 * i);
+        }
+
+        return value;
+    }
+
+    std::string_view bytes(size_t count)
+    {
+        if (data.size() - position < count) {
+            throw std::runtime_error("snapshot is truncated");
+        }
+
+        auto result = data.substr(position, count);
+        position += count;
+        return result;
+    }
+
+    bool atEnd() const { return position == data.size(); }
+
+private:
+    std::string_view data;
+    size_t position = 0;
+};
+
+} // namespace
+
+
+std::vector<uint8_t>
+snapshotCodes(const MonitorCapabilities& capabilities)
+{
+    std::vector<uint8_t> codes;
+    for (auto const& code : vcp::codes) {
+        if (capabilities.supports(code.code) && code.isSetting()
+            && code.type != VcpType::Table) {
+            codes.push_back(code.code);
+        }
+    }
+
+    return codes;
+}
+
+std::string
+encodeSnapshot(const Snapshot& snapshot)
+{
+    std::string out(magic);
+    out.push_back(static_cast<char>(version));
+    putInteger(out, snapshot.size(), 2);
+
+    for (auto const& [ key, values ] : snapshot) {
+        putInteger(out, std::stoull(key, nullptr, 16), 8);
+        putInteger(out, values.size(), 1);
+
+        for (auto const& value : values) {
+            putInteger(out, value.code, 1);
+            putInteger(out, value.value, 2);
+        }
+    }
+
+    return out;
+}
+
+Snapshot
+decodeSnapshot(std::string_view data)
+{
+    Reader reader(data);
+    if (reader.bytes(magic.size()) != magic || reader.integer(1) != version) {
+        throw std::runtime_error("not a ddccli snapshot");
+    }
+
+    static const char digits[] = "0123456789abcdef";
+
+    Snapshot snapshot;
+    for (auto monitors = reader.integer(2); monitors > 0; monitors--) {
+        // Back to the 16-digit form hashDeviceId returns
+        auto hash = reader.integer(8);
+        std::string key(16, '0');
+        for (int i = 15; i >= 0; i--) {
+            key[i] = digits[hash & 0xf];
+            hash >>= 4;
+        }
+
+        auto& values = snapshot[key];
+        for (auto count = reader.integer(1); count > 0; count--) {
+            auto code = static_cast<uint8_t>(reader.integer(1));
+            auto value = static_cast<uint16_t>(reader.integer(2));
+            values.push_back({ code, value });
+        }
+    }
+
+    if (!reader.atEnd()) {
+        throw std::runtime_error("unexpected data after snapshot");
+    }
+
+    return snapshot;
+}
@@ -0,0 +1,64 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "capabilities.h"
+
+
+struct SnapshotValue {
+    uint8_t code;
+    uint16_t value;
+};
+
+/**
+ * Saved VCP values per monitor, keyed by DeviceID hash (see hashDeviceId) so
+ * a snapshot restores to the same physical monitors.
+ */
+using Snapshot = std::map<std::string, std::vector<SnapshotValue>>;
+
+/**
+ * Codes worth saving for a monitor: known settings (see
+ * VcpCode::isSetting) it lists in its capabilities, except tables.
+ */
+std::vector<uint8_t>
+snapshotCodes(const MonitorCapabilities& capabilities);
+
+/**
+ * Binary snapshot file: "DDCS", a version byte and a monitor count, then per
+ * monitor its 8-byte DeviceID hash, a value count and 3 bytes per value (code
+ * and 16-bit value). Integers are little-endian.
+ */
+std::string
+encodeSnapshot(const Snapshot& snapshot);
+
+// Throws runtime_error if `data` isn't a valid snapshot
+Snapshot
+decodeSnapshot(std::string_view data);
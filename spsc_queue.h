@@ -0,0 +1,97 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <utility>
+
+
+/**
+ * Bounded lock-free single-producer/single-consumer ring.
+ *
+ * Each side keeps a cached copy of the other side's index and only reloads
+ * it when the ring looks full (producer) or empty (consumer), so in the
+ * common case push and pop touch no shared cache lines besides the slot.
+ */
+template<typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+                  "capacity must be a power of two");
+
+public:
+    // Producer only. Leaves `value` untouched when the ring is full, so a
+    // caller can retry with the same object.
+    template<typename U>
+    bool tryPush(U&& value)
+    {
+        auto tail = this->tail.load(std::memory_order_relaxed);
+        if (tail - cachedHead == Capacity) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (tail - cachedHead == Capacity) {
+                return false;
+            }
+        }
+
+        slots[tail & (Capacity - 1)] = std::forward<U>(value);
+        this->tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only
+    std::optional<T> tryPop()
+    {
+        auto head = this->head.load(std::memory_order_relaxed);
+        if (head == cachedTail) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (head == cachedTail) {
+                return std::nullopt;
+            }
+        }
+
+        std::optional<T> value = std::move(slots[head & (Capacity - 1)]);
+        this->head.store(head + 1, std::memory_order_release);
+        return value;
+    }
+
+    bool empty() const
+    {
+        return head.load(std::memory_order_acquire)
+               == tail.load(std::memory_order_acquire);
+    }
+
+private:
+    // Consumer-owned
+    alignas(64) std::atomic<size_t> head{ 0 };
+    size_t cachedTail = 0;
+
+    // Producer-owned
+    alignas(64) std::atomic<size_t> tail{ 0 };
+    size_t cachedHead = 0;
+
+    alignas(64) std::array<T, Capacity> slots{};
+};
@@ -0,0 +1,137 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "state.h"
+
+#include "windows.h"
+
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+
+std::filesystem::path
+getStateDirectory()
+{
+    char buffer[MAX_PATH];
+    DWORD length = GetEnvironmentVariableA("LOCALAPPDATA", buffer, MAX_PATH);
+
+    std::filesystem::path directory;
+    if (length == 0 || length >= MAX_PATH) {
+        directory = std::filesystem::temp_directory_path();
+    } else {
+        directory = std::string(buffer, length);
+    }
+
+    directory /= "ddccli";
+
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    if (ec) {
+        throw std::runtime_error("failed to create state directory");
+    }
+
+    return directory;
+}
+
+std::string
+hashDeviceId(std::string_view deviceId)
+{
+    // FNV-1a, 64-bit
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (unsigned char c : deviceId) {
+        hash ^= c;
+        hash *= 0x100000001b3ull;
+    }
+
+    static const char digits[] = "0123456789abcdef";
+
+    std::string key(16, '0');
+    for (int i = 15; i >= 0; i--) {
+        key[i] = digits[hash & 0xf];
+        hash >>= 4;
+    }
+
+    return key;
+}
+
+std::optional<std::string>
+readStateFile(const std::filesystem::path& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return std::nullopt;
+    }
+
+    return std::string(std::istreambuf_iterator<char>(file),
+                       std::istreambuf_iterator<char>());
+}
+
+void
+writeStateFile(const std::filesystem::path& path, std::string_view contents)
+{
+    std::filesystem::create_directories(path.parent_path());
+
+    auto tempPath = path;
+    tempPath += "." + std::to_string(GetCurrentProcessId()) + ".tmp";
+
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            throw std::runtime_error("failed to write state file");
+        }
+
+        file.write(contents.data(), contents.size());
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, path, ec);
+    if (ec) {
+        std::filesystem::remove(tempPath, ec);
+        throw std::runtime_error("failed to replace state file");
+    }
+}
+
+ScopedStateLock::ScopedStateLock(const std::filesystem::path& path)
+{
+    // Named after the whole path, so separate state directories don't
+    // contend
+    auto name = "Local\\ddccli-state-" + hashDeviceId(path.string());
+
+    mutex = CreateMutexA(NULL, FALSE, name.c_str());
+    if (mutex == NULL) {
+        throw std::runtime_error("failed to create state file lock");
+    }
+
+    // Abandoned means the owner died; its write was atomic either way
+    WaitForSingleObject(mutex, INFINITE);
+}
+
+ScopedStateLock::~ScopedStateLock()
+{
+    ReleaseMutex(mutex);
+    CloseHandle(mutex);
+}
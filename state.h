@@ -0,0 +1,76 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+#include "windows.h"
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+
+
+/**
+ * Per-user directory for persistent ddccli state (%LOCALAPPDATA%\ddccli).
+ * Created on first use.
+ */
+std::filesystem::path
+getStateDirectory();
+
+/**
+ * Stable key for a monitor, derived from the DeviceID recorded by
+ * populateHandlesMap. Used to name per-monitor state files.
+ */
+std::string
+hashDeviceId(std::string_view deviceId);
+
+std::optional<std::string>
+readStateFile(const std::filesystem::path& path);
+
+/**
+ * Replaces the file contents atomically so concurrent readers never observe
+ * a partially written file.
+ */
+void
+writeStateFile(const std::filesystem::path& path, std::string_view contents);
+
+
+/**
+ * Holds a cross-process lock on one state file for the enclosing scope, so
+ * read-merge-write cycles by concurrent ddccli processes don't lose each
+ * other's changes. Owned by the constructing thread, and freed if its
+ * process dies.
+ */
+class ScopedStateLock {
+public:
+    explicit ScopedStateLock(const std::filesystem::path& path);
+    ~ScopedStateLock();
+
+    ScopedStateLock(const ScopedStateLock&) = delete;
+    ScopedStateLock& operator=(const ScopedStateLock&) = delete;
+
+private:
+    HANDLE mutex;
+};
@@ -0,0 +1,120 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "sync_point.h"
+
+#include <algorithm>
+
+
+SyncPoint::SyncPoint(std::ptrdiff_t participants)
+  : barrier(participants, OnRelease{ this })
+{}
+
+void
+SyncPoint::OnRelease::operator()() noexcept
+{
+    // Runs once, before any participant is unblocked
+    point->releasedAt = Clock::now();
+}
+
+void
+SyncPoint::arriveAndWait()
+{
+    barrier.arrive_and_wait();
+}
+
+void
+SyncPoint::drop()
+{
+    barrier.arrive_and_drop();
+}
+
+void
+SyncPoint::complete(const std::string& id)
+{
+    auto now = Clock::now();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    completions[id] = now;
+}
+
+std::map<std::string, double>
+SyncPoint::completionTimes() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::map<std::string, double> times;
+    for (auto const& [ id, completedAt ] : completions) {
+        times[id] = std::chrono::duration<double, std::milli>(completedAt
+                                                              - releasedAt)
+                      .count();
+    }
+
+    return times;
+}
+
+double
+SyncPoint::spread() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (completions.empty()) {
+        return 0;
+    }
+
+    auto [ first, last ] = std::minmax_element(
+      completions.begin(), completions.end(), [](auto& a, auto& b) {
+          return a.second < b.second;
+      });
+
+    return std::chrono::duration<double, std::milli>(last->second
+                                                     - first->second)
+      .count();
+}
+
+
+SyncParticipant::SyncParticipant(SyncPoint* point) : point(point) {}
+
+SyncParticipant::~SyncParticipant()
+{
+    if (point && !arrived) {
+        point->drop();
+    }
+}
+
+void
+SyncParticipant::arriveAndWait()
+{
+    if (point && !arrived) {
+        arrived = true;
+        point->arriveAndWait();
+    }
+}
+
+void
+SyncParticipant::complete(const std::string& id)
+{
+    if (point) {
+        point->complete(id);
+    }
+}
@@ -0,0 +1,98 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <barrier>
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+
+
+/**
+ * Lines up writes to several monitors so they go out at the same instant,
+ * for changes that should land together on a video wall.
+ *
+ * Each monitor's worker arrives once its write is ready to go; all of them
+ * are released together when the last one arrives. Workers with nothing to
+ * write drop out instead, so they don't hold the rest up. Every participant
+ * must run on its own thread.
+ *
+ * Completion times are recorded to report the remaining skew.
+ */
+class SyncPoint {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit SyncPoint(std::ptrdiff_t participants);
+
+    void arriveAndWait();
+    void drop();
+
+    // Records when a released participant's write completed
+    void complete(const std::string& id);
+
+    // Milliseconds from the release to each completion
+    std::map<std::string, double> completionTimes() const;
+
+    // Milliseconds between the first and the last completion
+    double spread() const;
+
+private:
+    struct OnRelease {
+        SyncPoint* point;
+        void operator()() noexcept;
+    };
+
+    std::barrier<OnRelease> barrier;
+    Clock::time_point releasedAt;
+
+    mutable std::mutex mutex;
+    std::map<std::string, Clock::time_point> completions;
+};
+
+/**
+ * One worker's part in a SyncPoint. Drops out on destruction unless it
+ * arrived, so early returns can't leave the others waiting. With no
+ * SyncPoint every call does nothing.
+ */
+class SyncParticipant {
+public:
+    explicit SyncParticipant(SyncPoint* point);
+    ~SyncParticipant();
+
+    SyncParticipant(const SyncParticipant&) = delete;
+    SyncParticipant& operator=(const SyncParticipant&) = delete;
+
+    explicit operator bool() const { return point != nullptr; }
+
+    void arriveAndWait();
+    void complete(const std::string& id);
+
+private:
+    SyncPoint* point;
+    bool arrived = false;
+};
@@ -0,0 +1,93 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include "check.h"
+#include "fake_backend.h"
+
+namespace fs = std::filesystem;
+
+
+namespace {
+
+constexpr int processes = 16;
+constexpr int start = 30;
+
+std::string
+run(const std::string& ddccli, const std::string& arguments)
+{
+    auto outputPath = fs::temp_directory_path() / "ddccli-adjustment.out";
+    auto command =
+      "\"" + ddccli + "\" " + arguments + " > " + outputPath.string();
+    CHECK(std::system(command.c_str()) == 0);
+
+    std::ifstream output(outputPath);
+    return std::string(std::istreambuf_iterator<char>(output),
+                       std::istreambuf_iterator<char>());
+}
+
+} // namespace
+
+
+// Relative adjustments started at once are coalesced between processes, but
+// none of them may be lost
+int
+main(int argc, char* argv[])
+{
+    CHECK(argc == 2);
+    std::string ddccli = argv[1];
+
+    auto shared = fs::path(std::getenv("LOCALAPPDATA")) / "shared";
+    auto monitor = " -m '" + fake::deviceId(0) + "'";
+
+    setenv("FAKE_MONITORS", "1", 1);
+    setenv("FAKE_LATENCY_MS", "5", 1);
+
+    for (int round = 0; round < 3; round++) {
+        fs::remove_all(shared);
+        fs::create_directories(shared);
+        setenv("FAKE_SHARED_DIR", shared.c_str(), 1);
+
+        run(ddccli, "-b " + std::to_string(start) + monitor);
+
+        std::string command;
+        for (int i = 0; i < processes; i++) {
+            command += "\"" + ddccli + "\" -b +1" + monitor
+                       + " > /dev/null 2>&1 & ";
+        }
+
+        command += "wait";
+        CHECK(std::system(command.c_str()) == 0);
+
+        CHECK(run(ddccli, "-B" + monitor)
+              == std::to_string(start + processes) + "\n");
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,158 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "async.h"
+#include "bus_lock.h"
+#include "executor.h"
+#include "monitor.h"
+#include "rate_controller.h"
+#include "retry.h"
+
+
+namespace {
+
+constexpr uint8_t brightnessCode = 0x10;
+
+void
+report(const std::string& name,
+       size_t threads,
+       size_t reads,
+       size_t failed,
+       std::chrono::duration<double> elapsed)
+{
+    std::cout << name << ": " << threads << " threads, "
+              << elapsed.count() * 1000 << " ms, "
+              << static_cast<double>(reads) / elapsed.count() << " reads/s, "
+              << failed << " failed" << std::endl;
+}
+
+Task<void>
+readRepeatedly(AsyncMonitor& monitor, size_t count, size_t& failed)
+{
+    for (size_t i = 0; i < count; i++) {
+        if (!co_await monitor.tryGetVcp(brightnessCode)) {
+            failed++;
+        }
+    }
+}
+
+} // namespace
+
+
+/**
+ * Time for every simulated monitor to make a run of paced brightness reads,
+ * with one thread per monitor blocking through each transaction and the
+ * inter-message delay, and with coroutines on one EventLoop thread handing
+ * only the transactions themselves to a BusExecutor of a few sizes. Thread
+ * counts exclude the main thread.
+ *
+ * Usage: async_bench [reads per monitor]. The monitors' count and latency
+ * are FAKE_MONITORS and FAKE_LATENCY_MS, 16 and 40ms unless set.
+ */
+int
+main(int argc, char** argv)
+{
+    size_t perMonitor = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10;
+
+    setenv("FAKE_MONITORS", "16", 0);
+    setenv("FAKE_LATENCY_MS", "40", 0);
+    populateHandlesMap();
+
+    size_t reads = perMonitor * handles.size();
+
+    {
+        std::vector<std::thread> threads;
+        std::vector<size_t> failed(handles.size());
+        auto start = std::chrono::steady_clock::now();
+
+        size_t index = 0;
+        for (auto const& [ id, handle ] : handles) {
+            threads.emplace_back([&, &id = id, handle = handle, index] {
+                BusLock busLock(id);
+                auto& controller = busRateController(id);
+
+                for (size_t i = 0; i < perMonitor; i++) {
+                    ScopedBusLock lock(busLock);
+                    unsigned retries = 0;
+                    auto value = retryTransaction(
+                      defaultRetryPolicies.read,
+                      [&] {
+                          return pacedTransaction(controller, [&] {
+                              return tryGetVcpFeature(handle, brightnessCode);
+                          });
+                      },
+                      retries);
+                    failed[index] += !value;
+                }
+            });
+            index++;
+        }
+
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        size_t totalFailed = 0;
+        for (auto count : failed) {
+            totalFailed += count;
+        }
+
+        report("thread per monitor",
+               threads.size(),
+               reads,
+               totalFailed,
+               std::chrono::steady_clock::now() - start);
+    }
+
+    for (size_t executorThreads : { size_t(4), size_t(8), handles.size() }) {
+        EventLoop loop;
+        BusExecutor executor(executorThreads);
+        std::vector<std::unique_ptr<AsyncMonitor>> monitors;
+        size_t failed = 0;
+        auto start = std::chrono::steady_clock::now();
+
+        for (auto const& [ id, handle ] : handles) {
+            monitors.push_back(
+              std::make_unique<AsyncMonitor>(loop, executor, id, handle));
+            loop.spawn(readRepeatedly(*monitors.back(), perMonitor, failed));
+        }
+        loop.run();
+
+        report("coroutines",
+               1 + executorThreads,
+               reads,
+               failed,
+               std::chrono::steady_clock::now() - start);
+    }
+
+    return EXIT_SUCCESS;
+}
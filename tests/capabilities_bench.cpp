@@ -0,0 +1,91 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "capabilities.h"
+#include "capabilities_corpus.h"
+
+#include <json.hpp>
+
+
+/**
+ * Throughput of parseCapabilities over the corpus, and of the same parse
+ * followed by the nlohmann json conversion used for --capabilities output.
+ *
+ * Usage: capabilities_bench [rounds], one round parsing every corpus string.
+ */
+int
+main(int argc, char** argv)
+{
+    size_t rounds = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+
+    std::vector<std::string> corpus(std::begin(capabilitiesCorpus),
+                                    std::end(capabilitiesCorpus));
+
+    size_t bytesPerRound = 0;
+    for (auto const& raw : corpus) {
+        bytesPerRound += raw.size();
+    }
+
+    // Kept live so the work can't be optimised away
+    size_t checksum = 0;
+
+    auto measure = [&](const char* name, auto parse) {
+        auto start = std::chrono::steady_clock::now();
+
+        for (size_t round = 0; round < rounds; round++) {
+            for (auto const& raw : corpus) {
+                checksum += parse(raw);
+            }
+        }
+
+        std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - start;
+        double strings = static_cast<double>(rounds * corpus.size());
+
+        std::cout << name << ": " << elapsed.count() * 1e9 / strings
+                  << " ns/string, "
+                  << static_cast<double>(rounds * bytesPerRound)
+                       / elapsed.count() / (1 << 20)
+                  << " MiB/s" << std::endl;
+    };
+
+    // The copy into the parser's buffer is part of the cost, as in the tool
+    measure("parse", [](const std::string& raw) {
+        return parseCapabilities(raw).vcpCodes.count();
+    });
+
+    measure("parse+json", [](const std::string& raw) {
+        return nlohmann::json(parseCapabilities(raw)).dump().size();
+    });
+
+    std::cout << "checksum " << checksum << std::endl;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,91 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <string_view>
+
+using namespace std::string_view_literals;
+
+
+/**
+ * Capabilities strings in the shapes monitors actually report them, for the
+ * parser tests and benchmark: padding before closing parentheses, codes run
+ * together without spaces, nested groups in value lists, long manufacturer
+ * code ranges, missing outer parentheses and trailing NULs.
+ */
+inline constexpr std::string_view capabilitiesCorpus[] = {
+    // Dell U2415
+    "(prot(monitor)type(LCD)model(U2415)cmds(01 02 03 07 0C E3 F3)vcp(02 04 "
+    "05 08 10 12 14(01 05 08 0B 0C) 16 18 1A 52 60(01 0F 11 ) AA(01 02 04 ) "
+    "AC AE B2 B6 C6 C8 C9 D6(01 04 05) DC(00 02 03 05 ) DF E0 E1 E2(00 01 02 "
+    "04 0E 12 14 19 1D) F0(00 08) F1(01 ) F2 FD)mswhql(1)asset_eep(40)"
+    "mccs_ver(2.1))",
+
+    // LG 27UK850
+    "(prot(monitor)type(LCD)model(27UK850)cmds(01 02 03 0C E3 F3)vcp(02 04 05 "
+    "08 10 12 14(05 06 08 0B) 16 18 1A 52 60(0F 10 11 12 13) AC AE B2 B6 C0 "
+    "C6 C8 C9 D6(01 04) DF 62 8D F4 F5(00 01 02) F6(00 01 02) 4D 4E 4F 15(01 "
+    "06 07 10 11 13 14 28 29 32 48) F7(00 01 02 03) F8(00 01) F9 EF FD(00 01) "
+    "FE(00 01 02) FF)mccs_ver(2.1)mswhql(1))",
+
+    // HP E243
+    "(prot(monitor)type(LCD)model(HP E243)cmds(01 02 03 07 0C E3 F3)vcp(02 04 "
+    "05 08 0B 0C 10 12 14(01 02 04 05 08 0B) 16 18 1A 52 60(01 03 11 0F) 62 "
+    "6C 6E 70 86(02 0B) 87 8D(01 02) AC AE B6 C0 C6 C8 C9 CA(01 02) CC(02 03 "
+    "04 05 07 08 09 0A 0D 01 06 0B 12 14 16 1E) D6(01 04 05) DC(00 01 02 03 "
+    "04 05) DF E9(00 02) EA EB(01 02 03) EC ED EE FA(00 01 02) FB FC FD)"
+    "mswhql(1)asset_eep(40)mccs_ver(2.2))",
+
+    // Samsung S27D590, codes run together
+    "(prot(monitor)type(LCD)model(S27D590)cmds(01 02 03 07 0C E3 F3)vcp(0204"
+    "0508101214(05 08 0B 0C)16181A5260(01 03 04 05)ACAEB2B6C6C8C9CC(01 02 03 "
+    "04 05 06 07 08 09 0A 0C 0D 0E 14 16 1E)D6(01 04)DFFD)mccs_ver(2.1)"
+    "mswhql(1))",
+
+    // BenQ GW2780
+    "(prot(monitor)type(LCD)model(GW2780)cmds(01 02 03 07 0C F3)vcp(02 04 05 "
+    "08 0B 0C 10 12 14(04 05 08 0B) 16 18 1A 52 60(01 03 11) 62 8D(01 02) AC "
+    "AE B2 B6 C6 C8 CA DC(00 04 05 0B 0E 0F 10 11 12) DF)mswhql(1)"
+    "mccs_ver(2.2))",
+
+    // ASUS PA248, long manufacturer range
+    "(prot(monitor)type(LCD)model(PA248)cmds(01 02 03 07 0C F3)vcp(02 04 05 "
+    "08 0B 0C 10 12 14(05 06 08 0B) 16 18 1A 60(01 03 11 0F) 62 6C 6E 70 "
+    "8D(01 02) A8 AC AE B6 C6 C8 C9 CC(01 02 03 04 05 06 07 08 09 0A 0C 0D "
+    "11 12 14 1A 1E 1F 23 30 31) D6(01 04 05) DC(01 02 03 04 05 06 07 08 09 "
+    "0A 0B 0C 0D 0E 0F 10 11 12 13 14 15 16 17 18) DF E0 E1 E2 E3 E4 E5 E6 "
+    "E7 E8 E9 EA EB EC ED EE EF F0 F1 F2 F3 F4 F5 F6 F7 F8 F9 FA FB FC FD FE "
+    "FF)mswhql(1)asset_eep(40)mccs_ver(2.1))",
+
+    // EIZO EV2456, nested value groups (MCCS 3.0 style)
+    "(prot(monitor)type(lcd)model(EV2456)cmds(01 02 03 07 0C F3)vcp(02 04 05 "
+    "08 10 12 14(01 05 06 08 0B) 16 18 1A 60(01 03 0F 11) 62 8D(01 02) "
+    "DC(00(01 02) 03 04) D6(01 04 05) DF)mccs_ver(3.0))",
+
+    // Lenovo P27h, without outer parentheses and with trailing NULs
+    "prot(monitor)type(LCD)model(P27h-10)cmds(01 02 03 07 0C E3 F3)vcp(02 04 "
+    "05 08 10 12 14(01 05 06 08 0B) 16 18 1A 52 60(0F 11 12) AC AE B2 B6 C6 "
+    "C8 C9 D6(01 04 05) DF)mswhql(1)mccs_ver(2.2)\0\0"sv,
+};
@@ -0,0 +1,158 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "capabilities.h"
+#include "capabilities_corpus.h"
+#include "check.h"
+
+#include <json.hpp>
+
+
+namespace {
+
+std::vector<uint8_t>
+allowed(const MonitorCapabilities& capabilities, uint8_t code)
+{
+    auto values = capabilities.allowedValues(code);
+    return { values.begin(), values.end() };
+}
+
+void
+parsesCorpus()
+{
+    for (auto raw : capabilitiesCorpus) {
+        auto capabilities = parseCapabilities(std::string(raw));
+
+        CHECK(capabilities.get(capabilities.protocol) == "monitor");
+        CHECK(!capabilities.get(capabilities.model).empty());
+        CHECK(capabilities.supports(0x10));
+        CHECK(capabilities.supports(0x12));
+    }
+}
+
+void
+readsFields()
+{
+    auto capabilities = parseCapabilities(std::string(capabilitiesCorpus[0]));
+
+    CHECK(capabilities.get(capabilities.type) == "LCD");
+    CHECK(capabilities.get(capabilities.model) == "U2415");
+    CHECK(capabilities.get(capabilities.mccsVersion) == "2.1");
+
+    // Padded before the closing parenthesis
+    CHECK(allowed(capabilities, 0x60) == (std::vector<uint8_t>{ 1, 15, 17 }));
+    CHECK(allowed(capabilities, 0xf1) == (std::vector<uint8_t>{ 1 }));
+    CHECK(capabilities.allowedValues(0x10).empty());
+    CHECK(!capabilities.supports(0x11));
+}
+
+void
+readsCodesRunTogether()
+{
+    auto capabilities = parseCapabilities(std::string(capabilitiesCorpus[3]));
+
+    for (uint8_t code : { 0x02, 0x04, 0x05, 0x08, 0x10, 0x12, 0x16, 0xfd }) {
+        CHECK(capabilities.supports(code));
+    }
+
+    CHECK(allowed(capabilities, 0x14)
+          == (std::vector<uint8_t>{ 0x05, 0x08, 0x0b, 0x0c }));
+}
+
+void
+flattensNestedValues()
+{
+    auto capabilities = parseCapabilities(std::string(capabilitiesCorpus[6]));
+
+    CHECK(allowed(capabilities, 0xdc)
+          == (std::vector<uint8_t>{ 0, 1, 2, 3, 4 }));
+    CHECK(capabilities.supports(0xd6));
+}
+
+void
+acceptsMissingParenthesesAndNuls()
+{
+    auto capabilities = parseCapabilities(std::string(capabilitiesCorpus[7]));
+
+    CHECK(capabilities.get(capabilities.model) == "P27h-10");
+    CHECK(capabilities.get(capabilities.mccsVersion) == "2.2");
+    CHECK(allowed(capabilities, 0xd6) == (std::vector<uint8_t>{ 1, 4, 5 }));
+}
+
+void
+rejectsMalformed()
+{
+    CHECK_THROWS(parseCapabilities("(prot(monitor)vcp(10 12)"));
+    CHECK_THROWS(parseCapabilities("(vcp(10 1))"));
+    CHECK_THROWS(parseCapabilities("(vcp(10 XY))"));
+    CHECK_THROWS(parseCapabilities("(vcp((01) 10))"));
+}
+
+void
+survivesCopies()
+{
+    auto original = std::make_unique<MonitorCapabilities>(
+      parseCapabilities(std::string(capabilitiesCorpus[1])));
+    auto copy = *original;
+    original.reset();
+
+    CHECK(copy.get(copy.model) == "27UK850");
+    CHECK(allowed(copy, 0xf7) == (std::vector<uint8_t>{ 0, 1, 2, 3 }));
+}
+
+void
+convertsToJson()
+{
+    auto raw = std::string(capabilitiesCorpus[0]);
+    nlohmann::json j = parseCapabilities(raw);
+
+    CHECK(j["raw"] == raw);
+    CHECK(j["model"] == "U2415");
+    CHECK(j["vcp"]["60"] == nlohmann::json({ 1, 15, 17 }));
+    CHECK(j["vcp"]["10"] == nlohmann::json::array());
+    CHECK(j["vcp"].count("11") == 0);
+}
+
+} // namespace
+
+
+int
+main()
+{
+    parsesCorpus();
+    readsFields();
+    readsCodesRunTogether();
+    flattensNestedValues();
+    acceptsMissingParenthesesAndNuls();
+    rejectsMalformed();
+    survivesCopies();
+    convertsToJson();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,123 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "executor.h"
+
+
+namespace {
+
+constexpr size_t buses = 48;
+constexpr std::chrono::milliseconds baseLatency{ 2 };
+
+// Buses further down a chain of MST hubs answer more slowly, up to 8 times
+// the first
+std::chrono::milliseconds
+latency(size_t bus)
+{
+    return baseLatency * static_cast<int>(1 + bus / 6);
+}
+
+void
+report(const char* name, std::chrono::duration<double> elapsed)
+{
+    std::cout << name << ": " << elapsed.count() * 1000 << " ms" << std::endl;
+}
+
+} // namespace
+
+
+/**
+ * Makespan of a bulk operation over 48 simulated buses with skewed latencies,
+ * on the work-stealing BusExecutor and on the same number of threads each
+ * given a fixed, contiguous share of the buses. Transactions are sleeps, so
+ * only scheduling is measured.
+ *
+ * Usage: executor_bench [transactions per bus]
+ */
+int
+main(int argc, char** argv)
+{
+    size_t perBus = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10;
+    size_t threadCount = defaultExecutorThreads(buses);
+
+    std::chrono::milliseconds total{ 0 };
+    for (size_t bus = 0; bus < buses; bus++) {
+        total += latency(bus) * static_cast<int>(perBus);
+    }
+
+    // Neither can beat perfect balance, nor the slowest bus on its own
+    auto bound = (std::max)(total / static_cast<int>(threadCount),
+                            latency(buses - 1) * static_cast<int>(perBus));
+    std::cout << threadCount << " threads, lower bound " << bound.count()
+              << " ms" << std::endl;
+
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < threadCount; t++) {
+            threads.emplace_back([=] {
+                auto first = t * buses / threadCount;
+                auto last = (t + 1) * buses / threadCount;
+                for (size_t bus = first; bus < last; bus++) {
+                    for (size_t i = 0; i < perBus; i++) {
+                        std::this_thread::sleep_for(latency(bus));
+                    }
+                }
+            });
+        }
+
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        report("static", std::chrono::steady_clock::now() - start);
+    }
+
+    {
+        BusExecutor executor(threadCount);
+        auto start = std::chrono::steady_clock::now();
+
+        for (size_t bus = 0; bus < buses; bus++) {
+            for (size_t i = 0; i < perBus; i++) {
+                executor.submit(std::to_string(bus), [=] {
+                    std::this_thread::sleep_for(latency(bus));
+                });
+            }
+        }
+        executor.wait();
+
+        report("work-stealing", std::chrono::steady_clock::now() - start);
+    }
+
+    return EXIT_SUCCESS;
+}
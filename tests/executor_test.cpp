@@ -0,0 +1,148 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "check.h"
+#include "executor.h"
+
+
+namespace {
+
+void
+runsEachBusSeriallyInOrder()
+{
+    constexpr int busCount = 8;
+    constexpr int jobsPerBus = 200;
+
+    BusExecutor executor(4);
+
+    std::vector<std::atomic<bool>> running(busCount);
+    std::vector<std::vector<int>> order(busCount);
+
+    for (int job = 0; job < jobsPerBus; job++) {
+        for (int bus = 0; bus < busCount; bus++) {
+            executor.submit("bus" + std::to_string(bus), [&, bus, job] {
+                CHECK(!running[bus].exchange(true));
+                order[bus].push_back(job);
+                std::this_thread::yield();
+                running[bus] = false;
+            });
+        }
+    }
+
+    executor.wait();
+
+    for (auto const& jobs : order) {
+        CHECK(jobs.size() == jobsPerBus);
+        for (int job = 0; job < jobsPerBus; job++) {
+            CHECK(jobs[job] == job);
+        }
+    }
+}
+
+void
+slowBusDoesNotHoldUpOthers()
+{
+    using namespace std::chrono_literals;
+    using Clock = std::chrono::steady_clock;
+
+    BusExecutor executor(2);
+    auto start = Clock::now();
+
+    std::mutex mutex;
+    Clock::time_point fastDone;
+
+    for (int job = 0; job < 5; job++) {
+        executor.submit("slow", [] { std::this_thread::sleep_for(100ms); });
+    }
+
+    for (int bus = 0; bus < 4; bus++) {
+        for (int job = 0; job < 20; job++) {
+            executor.submit("fast" + std::to_string(bus), [&] {
+                std::this_thread::sleep_for(1ms);
+                std::lock_guard<std::mutex> lock(mutex);
+                fastDone = (std::max)(fastDone, Clock::now());
+            });
+        }
+    }
+
+    executor.wait();
+
+    // Serialised behind the slow bus they would take over 500ms
+    CHECK(fastDone - start < 400ms);
+}
+
+void
+rethrowsJobErrors()
+{
+    BusExecutor executor(2);
+    std::atomic<int> ran{ 0 };
+
+    executor.submit("a", [] { throw std::runtime_error("failed"); });
+    executor.submit("b", [&] { ran++; });
+    CHECK_THROWS(executor.wait());
+    CHECK(ran == 1);
+
+    // Still usable afterwards
+    executor.submit("a", [&] { ran++; });
+    executor.wait();
+    CHECK(ran == 2);
+}
+
+void
+visitsEveryMonitor()
+{
+    std::map<std::string, int> monitors = { { "a", 1 }, { "b", 2 }, { "c", 3 } };
+    std::atomic<int> sum{ 0 };
+
+    BusExecutor executor(defaultExecutorThreads(monitors.size()));
+    forEachMonitor(executor, monitors, [&](const std::string&, int value) {
+        sum += value;
+    });
+
+    CHECK(sum == 6);
+}
+
+} // namespace
+
+
+int
+main()
+{
+    runsEachBusSeriallyInOrder();
+    slowBusDoesNotHoldUpOthers();
+    rethrowsJobErrors();
+    visitsEveryMonitor();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,868 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "fake_backend.h"
+
+#include "windows.h"
+
+#include "HighLevelMonitorConfigurationAPI.h"
+#include "LowLevelMonitorConfigurationAPI.h"
+#include "PhysicalMonitorEnumerationAPI.h"
+#include "winuser.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+thread_local DWORD lastError = ERROR_SUCCESS;
+
+unsigned long
+setting(const char* name, unsigned long fallback)
+{
+    const char* value = std::getenv(name);
+    return value ? std::strtoul(value, nullptr, 10) : fallback;
+}
+
+constexpr size_t maxMonitors = 16;
+
+size_t
+monitorCount()
+{
+    return (std::min)(setting("FAKE_MONITORS", 2), maxMonitors);
+}
+
+
+// File in FAKE_SHARED_DIR standing in for a named object, or -1 when the
+// object is private to the process
+int
+openSharedFile(LPCSTR name)
+{
+    const char* directory = std::getenv("FAKE_SHARED_DIR");
+    if (!name || !directory) {
+        return -1;
+    }
+
+    std::string path = name;
+    std::replace(path.begin(), path.end(), '\\', '_');
+
+    return open(
+      (std::string(directory) + "/" + path).c_str(), O_CREAT | O_RDWR, 0600);
+}
+
+
+// Kernel objects. Named ones are shared by name until the last handle to
+// them is closed, as on Windows, but only within the process. With
+// FAKE_SHARED_DIR set, named mutexes and mappings are also backed by files
+// there, so separate processes share them; those live as long as the files.
+
+struct Object {
+    virtual ~Object() = default;
+};
+
+struct Mutex : Object {
+    explicit Mutex(LPCSTR name)
+      : file(openSharedFile(name))
+    {}
+
+    ~Mutex() override
+    {
+        if (file >= 0) {
+            close(file);
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable released;
+    std::thread::id owner;
+    unsigned recursion = 0;
+
+    // Locked while a thread of this process owns the mutex. A process that
+    // dies drops the lock, though the next owner can't tell it was
+    // abandoned.
+    int file;
+};
+
+struct Event : Object {
+    Event(bool manualReset, bool isSet)
+      : manualReset(manualReset)
+      , isSet(isSet)
+    {}
+
+    std::mutex mutex;
+    std::condition_variable signalled;
+    bool manualReset;
+    bool isSet;
+};
+
+struct Mapping : Object {
+    Mapping(size_t size, LPCSTR name)
+      : size(size)
+    {
+        int file = openSharedFile(name);
+        if (file < 0) {
+            memory.resize((size + sizeof(std::max_align_t) - 1)
+                          / sizeof(std::max_align_t));
+            view = memory.data();
+            return;
+        }
+
+        // Only ever grown, so another process's view stays valid
+        if (lseek(file, 0, SEEK_END) < static_cast<off_t>(size)) {
+            ftruncate(file, size);
+        }
+
+        view = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+        if (view == MAP_FAILED) {
+            view = nullptr;
+        }
+
+        close(file);
+    }
+
+    ~Mapping() override
+    {
+        if (memory.empty() && view) {
+            munmap(view, size);
+        }
+    }
+
+    size_t size;
+    void* view;
+
+    // Zero-filled, like a fresh mapping
+    std::vector<std::max_align_t> memory;
+};
+
+struct Handle {
+    std::shared_ptr<Object> object;
+};
+
+std::mutex namedMutex;
+std::map<std::string, std::weak_ptr<Object>> named;
+
+template<typename T, typename... Args>
+HANDLE
+openObject(LPCSTR name, Args... args)
+{
+    if (!name) {
+        return new Handle{ std::make_shared<T>(args...) };
+    }
+
+    std::lock_guard<std::mutex> lock(namedMutex);
+
+    auto object = named[name].lock();
+    if (!object) {
+        object = std::make_shared<T>(args...);
+        named[name] = object;
+    }
+
+    return new Handle{ object };
+}
+
+template<typename T>
+T*
+objectOf(HANDLE handle)
+{
+    return dynamic_cast<T*>(static_cast<Handle*>(handle)->object.get());
+}
+
+// Waits for `ready` under `lock`, for up to `milliseconds`
+template<typename Lock, typename Ready>
+bool
+waitFor(std::condition_variable& condition,
+        Lock& lock,
+        DWORD milliseconds,
+        Ready ready)
+{
+    if (milliseconds == INFINITE) {
+        condition.wait(lock, ready);
+        return true;
+    }
+
+    return condition.wait_for(
+      lock, std::chrono::milliseconds(milliseconds), ready);
+}
+
+
+// Monitors
+
+constexpr std::string_view capabilities =
+  "(prot(monitor)type(lcd)model(FAKE)cmds(01 02 03 07 0C F3)vcp(02 10 12 "
+  "14(05 06 08) 60(0F 11 12) 62 D6(01 04 05) DC(00 02) E0)mccs_ver(2.2))";
+
+// 0xE0 is manufacturer-specific, so it has no name in vcp.h
+constexpr uint8_t supportedCodes[] = { 0x02, 0x10, 0x12, 0x14, 0x60,
+                                       0x62, 0xd6, 0xdc, 0xe0 };
+
+struct Monitor {
+    std::map<uint8_t, DWORD> values;
+    std::atomic<unsigned> transactions{ 0 };
+    std::atomic<unsigned> inFlight{ 0 };
+};
+
+/**
+ * With FAKE_SHARED_DIR set, every process's monitors keep their values in
+ * one mapped file instead of Monitor::values, one slot per monitor and code.
+ * Slots hold the value plus one, so the zero-filled file reads as unset.
+ */
+DWORD*
+sharedValues()
+{
+    constexpr size_t size = maxMonitors * 256 * sizeof(DWORD);
+
+    // Per process; tests set the directory before the first call
+    static auto values = [] {
+        int file = openSharedFile("monitor-values");
+        if (file < 0) {
+            return static_cast<DWORD*>(nullptr);
+        }
+
+        if (lseek(file, 0, SEEK_END) < static_cast<off_t>(size)) {
+            ftruncate(file, size);
+        }
+
+        void* view =
+          mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+        close(file);
+        return view == MAP_FAILED ? nullptr : static_cast<DWORD*>(view);
+    }();
+
+    return values;
+}
+
+std::atomic_ref<DWORD>
+sharedSlot(size_t monitor, uint8_t code)
+{
+    return std::atomic_ref<DWORD>(sharedValues()[monitor * 256 + code]);
+}
+
+struct Backend {
+    std::mutex mutex;
+    std::array<Monitor, maxMonitors> monitors;
+    std::vector<fake::Write> writes;
+    std::mt19937 random{ 1 };
+    std::atomic<unsigned> overlaps{ 0 };
+};
+
+// Never freed, as abandoned calls may outlive static destruction
+Backend&
+backend()
+{
+    static auto backend = new Backend;
+    return *backend;
+}
+
+std::string
+displayName(size_t monitor)
+{
+    return "\\\\.\\DISPLAY" + std::to_string(monitor + 1);
+}
+
+// Physical monitor handles and HMONITORs are the monitor index plus one
+size_t
+indexOf(const void* handle)
+{
+    return static_cast<size_t>(reinterpret_cast<intptr_t>(handle)) - 1;
+}
+
+DWORD
+defaultValue(uint8_t code)
+{
+    switch (code) {
+        case 0x60:
+            return 0x0f;
+        case 0xd6:
+            return 0x01;
+        default:
+            return 50;
+    }
+}
+
+/**
+ * One DDC/CI transaction with `handle`'s monitor: counts it, takes the
+ * configured latency, and fails it with a bad checksum at the configured
+ * rate. `fn(monitor, index)` runs when the monitor receives the request.
+ */
+template<typename Fn>
+BOOL
+transaction(HANDLE handle, Fn fn)
+{
+    auto index = indexOf(handle);
+    if (index >= monitorCount()) {
+        SetLastError(ERROR_GRAPHICS_INVALID_PHYSICAL_MONITOR_HANDLE);
+        return FALSE;
+    }
+
+    auto& state = backend();
+    auto& monitor = state.monitors[index];
+
+    monitor.transactions++;
+    if (monitor.inFlight++ > 0) {
+        state.overlaps++;
+    }
+
+    bool failed = false;
+    if (auto percent = setting("FAKE_FAILURE_PERCENT", 0)) {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        failed = std::uniform_int_distribution<unsigned long>(0, 99)(
+                   state.random)
+                 < percent;
+    }
+
+    BOOL ok = FALSE;
+    if (failed) {
+        SetLastError(ERROR_GRAPHICS_DDCCI_INVALID_MESSAGE_CHECKSUM);
+    } else {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        ok = fn(monitor, index);
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(
+      setting("FAKE_LATENCY_MS", 0)
+      + index * setting("FAKE_LATENCY_STEP_MS", 0)));
+
+    monitor.inFlight--;
+    return ok;
+}
+
+bool
+isSupported(uint8_t code)
+{
+    return std::find(std::begin(supportedCodes), std::end(supportedCodes), code)
+           != std::end(supportedCodes);
+}
+
+BOOL
+readValue(HANDLE handle, BYTE code, LPDWORD current, LPDWORD maximum)
+{
+    return transaction(handle, [&](Monitor& monitor, size_t index) -> BOOL {
+        if (!isSupported(code)) {
+            SetLastError(ERROR_GRAPHICS_DDCCI_VCP_NOT_SUPPORTED);
+            return FALSE;
+        }
+
+        if (sharedValues()) {
+            auto stored = sharedSlot(index, code).load();
+            *current = stored != 0 ? stored - 1 : defaultValue(code);
+        } else {
+            auto value = monitor.values.find(code);
+            *current = value != monitor.values.end() ? value->second
+                                                     : defaultValue(code);
+        }
+
+        *maximum = 100;
+        return TRUE;
+    });
+}
+
+// Caller holds the backend mutex
+void
+recordWrite(size_t index, BYTE code, DWORD value)
+{
+    auto now = Clock::now();
+    backend().writes.push_back({ index, code, value, now });
+
+    if (const char* path = std::getenv("FAKE_WRITE_LOG")) {
+        std::ofstream log(path, std::ios::app);
+        log << index << " " << int(code) << " " << value << " "
+            << std::chrono::duration_cast<std::chrono::nanoseconds>(
+                 now.time_since_epoch())
+                 .count()
+            << "\n";
+    }
+}
+
+BOOL
+writeValue(HANDLE handle, BYTE code, DWORD value)
+{
+    return transaction(handle, [&](Monitor& monitor, size_t index) -> BOOL {
+        if (!isSupported(code)) {
+            SetLastError(ERROR_GRAPHICS_DDCCI_VCP_NOT_SUPPORTED);
+            return FALSE;
+        }
+
+        if (sharedValues()) {
+            sharedSlot(index, code).store(value + 1);
+        } else {
+            monitor.values[code] = value;
+        }
+
+        recordWrite(index, code, value);
+        return TRUE;
+    });
+}
+
+} // namespace
+
+
+namespace fake {
+
+std::string
+deviceId(size_t monitor)
+{
+    char id[128];
+    std::snprintf(id,
+                  sizeof(id),
+                  "\\\\?\\DISPLAY#FAK%04zu#5&1a2b3c4d&0&UID%zu#"
+                  "{e6f07b5f-ee97-4a90-b076-33f57bf4eaa7}",
+                  monitor,
+                  monitor + 256);
+    return id;
+}
+
+unsigned
+transactions(size_t monitor)
+{
+    return backend().monitors.at(monitor).transactions;
+}
+
+unsigned
+overlaps()
+{
+    return backend().overlaps;
+}
+
+std::vector<Write>
+writes()
+{
+    std::lock_guard<std::mutex> lock(backend().mutex);
+    return backend().writes;
+}
+
+void
+reset()
+{
+    auto& state = backend();
+    std::lock_guard<std::mutex> lock(state.mutex);
+
+    for (auto& monitor : state.monitors) {
+        monitor.values.clear();
+        monitor.transactions = 0;
+    }
+
+    state.writes.clear();
+    state.random.seed(1);
+    state.overlaps = 0;
+}
+
+} // namespace fake
+
+
+DWORD
+GetLastError()
+{
+    return lastError;
+}
+
+void
+SetLastError(DWORD error)
+{
+    lastError = error;
+}
+
+DWORD
+GetTickCount()
+{
+    return static_cast<DWORD>(
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+        Clock::now().time_since_epoch())
+        .count());
+}
+
+DWORD
+GetCurrentProcessId()
+{
+    return static_cast<DWORD>(getpid());
+}
+
+void
+Sleep(DWORD milliseconds)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+}
+
+DWORD
+GetEnvironmentVariableA(LPCSTR name, LPSTR buffer, DWORD size)
+{
+    const char* value = std::getenv(name);
+    if (!value) {
+        return 0;
+    }
+
+    // Without room for the value, the size needed including the NUL
+    auto length = static_cast<DWORD>(std::strlen(value));
+    if (length >= size) {
+        return length + 1;
+    }
+
+    std::memcpy(buffer, value, length + 1);
+    return length;
+}
+
+BOOL
+CloseHandle(HANDLE object)
+{
+    delete static_cast<Handle*>(object);
+    return TRUE;
+}
+
+DWORD
+WaitForSingleObject(HANDLE object, DWORD milliseconds)
+{
+    if (auto mutex = objectOf<Mutex>(object)) {
+        auto self = std::this_thread::get_id();
+        auto deadline = Clock::now() + std::chrono::milliseconds(milliseconds);
+
+        std::unique_lock<std::mutex> lock(mutex->mutex);
+        if (!waitFor(mutex->released, lock, milliseconds, [&] {
+                return mutex->recursion == 0 || mutex->owner == self;
+            })) {
+            return WAIT_TIMEOUT;
+        }
+
+        mutex->owner = self;
+        if (mutex->recursion++ > 0 || mutex->file < 0) {
+            return WAIT_OBJECT_0;
+        }
+
+        // Owned within the process; now contend with the other processes
+        lock.unlock();
+        while (flock(mutex->file, LOCK_EX | LOCK_NB) != 0) {
+            if (milliseconds != INFINITE && Clock::now() >= deadline) {
+                lock.lock();
+                mutex->recursion = 0;
+                mutex->owner = {};
+                mutex->released.notify_all();
+                return WAIT_TIMEOUT;
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        return WAIT_OBJECT_0;
+    }
+
+    if (auto event = objectOf<Event>(object)) {
+        std::unique_lock<std::mutex> lock(event->mutex);
+        if (!waitFor(event->signalled, lock, milliseconds, [&] {
+                return event->isSet;
+            })) {
+            return WAIT_TIMEOUT;
+        }
+
+        if (!event->manualReset) {
+            event->isSet = false;
+        }
+        return WAIT_OBJECT_0;
+    }
+
+    return WAIT_FAILED;
+}
+
+HANDLE
+CreateMutexA(LPSECURITY_ATTRIBUTES, BOOL initialOwner, LPCSTR name)
+{
+    auto handle = openObject<Mutex>(name, name);
+    if (initialOwner) {
+        WaitForSingleObject(handle, INFINITE);
+    }
+
+    return handle;
+}
+
+BOOL
+ReleaseMutex(HANDLE handle)
+{
+    auto mutex = objectOf<Mutex>(handle);
+
+    std::lock_guard<std::mutex> lock(mutex->mutex);
+    if (mutex->recursion == 0
+        || mutex->owner != std::this_thread::get_id()) {
+        return FALSE;
+    }
+
+    if (--mutex->recursion == 0) {
+        if (mutex->file >= 0) {
+            flock(mutex->file, LOCK_UN);
+        }
+
+        mutex->owner = {};
+        mutex->released.notify_all();
+    }
+
+    return TRUE;
+}
+
+HANDLE
+CreateEventA(LPSECURITY_ATTRIBUTES,
+             BOOL manualReset,
+             BOOL initialState,
+             LPCSTR name)
+{
+    return openObject<Event>(name, manualReset != FALSE, initialState != FALSE);
+}
+
+BOOL
+SetEvent(HANDLE handle)
+{
+    auto event = objectOf<Event>(handle);
+
+    std::lock_guard<std::mutex> lock(event->mutex);
+    event->isSet = true;
+    event->signalled.notify_all();
+    return TRUE;
+}
+
+HANDLE
+CreateFileMappingA(HANDLE,
+                   LPSECURITY_ATTRIBUTES,
+                   DWORD,
+                   DWORD,
+                   DWORD sizeLow,
+                   LPCSTR name)
+{
+    return openObject<Mapping>(name, size_t(sizeLow), name);
+}
+
+void*
+MapViewOfFile(HANDLE mapping, DWORD, DWORD, DWORD, SIZE_T)
+{
+    return objectOf<Mapping>(mapping)->view;
+}
+
+BOOL
+UnmapViewOfFile(const void*)
+{
+    return TRUE;
+}
+
+LONG
+InterlockedIncrement(volatile LONG* target)
+{
+    return std::atomic_ref<LONG>(const_cast<LONG&>(*target)).fetch_add(1) + 1;
+}
+
+LONG
+InterlockedExchange(volatile LONG* target, LONG value)
+{
+    return std::atomic_ref<LONG>(const_cast<LONG&>(*target)).exchange(value);
+}
+
+LONG
+InterlockedExchangeAdd(volatile LONG* target, LONG value)
+{
+    return std::atomic_ref<LONG>(const_cast<LONG&>(*target)).fetch_add(value);
+}
+
+LONG
+InterlockedCompareExchange(volatile LONG* target, LONG exchange, LONG compare)
+{
+    std::atomic_ref<LONG>(const_cast<LONG&>(*target))
+      .compare_exchange_strong(compare, exchange);
+    return compare;
+}
+
+
+BOOL
+EnumDisplayMonitors(HDC, LPRECT, MONITORENUMPROC callback, LPARAM data)
+{
+    for (size_t i = 0; i < monitorCount(); i++) {
+        auto monitor = reinterpret_cast<HMONITOR>(intptr_t(i + 1));
+        if (!callback(monitor, nullptr, nullptr, data)) {
+            break;
+        }
+    }
+
+    return TRUE;
+}
+
+BOOL
+GetMonitorInfo(HMONITOR monitor, MONITORINFOEX* info)
+{
+    auto name = displayName(indexOf(monitor));
+    std::snprintf(info->szDevice, sizeof(info->szDevice), "%s", name.c_str());
+    return TRUE;
+}
+
+BOOL
+EnumDisplayDevices(LPCSTR device,
+                   DWORD index,
+                   DISPLAY_DEVICE* displayDevice,
+                   DWORD)
+{
+    auto copy = [](auto& field, const std::string& value) {
+        std::snprintf(field, sizeof(field), "%s", value.c_str());
+    };
+
+    // Adapters, one per monitor
+    if (!device) {
+        if (index >= monitorCount()) {
+            return FALSE;
+        }
+
+        copy(displayDevice->DeviceName, displayName(index));
+        copy(displayDevice->DeviceID, "PCI\\VEN_FAKE");
+        displayDevice->StateFlags = DISPLAY_DEVICE_ATTACHED_TO_DESKTOP;
+        return TRUE;
+    }
+
+    for (size_t monitor = 0; monitor < monitorCount(); monitor++) {
+        if (index == 0 && device == displayName(monitor)) {
+            copy(displayDevice->DeviceName,
+                 std::string(device) + "\\Monitor0");
+            copy(displayDevice->DeviceID, fake::deviceId(monitor));
+            displayDevice->StateFlags = DISPLAY_DEVICE_ATTACHED_TO_DESKTOP;
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+BOOL
+GetNumberOfPhysicalMonitorsFromHMONITOR(HMONITOR, LPDWORD count)
+{
+    *count = 1;
+    return TRUE;
+}
+
+BOOL
+GetPhysicalMonitorsFromHMONITOR(HMONITOR monitor,
+                                DWORD,
+                                LPPHYSICAL_MONITOR physicalMonitors)
+{
+    physicalMonitors[0].hPhysicalMonitor = monitor;
+    std::snprintf(physicalMonitors[0].szPhysicalMonitorDescription,
+                  sizeof(physicalMonitors[0].szPhysicalMonitorDescription),
+                  "Fake monitor %zu",
+                  indexOf(monitor));
+    return TRUE;
+}
+
+BOOL
+DestroyPhysicalMonitor(HANDLE)
+{
+    return TRUE;
+}
+
+
+BOOL
+GetVCPFeatureAndVCPFeatureReply(HANDLE monitor,
+                                BYTE code,
+                                LPMC_VCP_CODE_TYPE type,
+                                LPDWORD current,
+                                LPDWORD maximum)
+{
+    if (type) {
+        *type = MC_SET_PARAMETER;
+    }
+
+    return readValue(monitor, code, current, maximum);
+}
+
+BOOL
+SetVCPFeature(HANDLE monitor, BYTE code, DWORD value)
+{
+    return writeValue(monitor, code, value);
+}
+
+BOOL
+GetCapabilitiesStringLength(HANDLE monitor, LPDWORD length)
+{
+    return transaction(monitor, [&](Monitor&, size_t) -> BOOL {
+        *length = static_cast<DWORD>(capabilities.size() + 1);
+        return TRUE;
+    });
+}
+
+BOOL
+CapabilitiesRequestAndCapabilitiesReply(HANDLE monitor,
+                                        LPSTR buffer,
+                                        DWORD length)
+{
+    return transaction(monitor, [&](Monitor&, size_t) -> BOOL {
+        if (length < capabilities.size() + 1) {
+            SetLastError(ERROR_GRAPHICS_MCA_INVALID_CAPABILITIES_STRING);
+            return FALSE;
+        }
+
+        capabilities.copy(buffer, capabilities.size());
+        buffer[capabilities.size()] = '\0';
+        return TRUE;
+    });
+}
+
+BOOL
+GetMonitorBrightness(HANDLE monitor,
+                     LPDWORD minimum,
+                     LPDWORD current,
+                     LPDWORD maximum)
+{
+    *minimum = 0;
+    return readValue(monitor, 0x10, current, maximum);
+}
+
+BOOL
+SetMonitorBrightness(HANDLE monitor, DWORD brightness)
+{
+    return writeValue(monitor, 0x10, brightness);
+}
+
+BOOL
+GetMonitorContrast(HANDLE monitor,
+                   LPDWORD minimum,
+                   LPDWORD current,
+                   LPDWORD maximum)
+{
+    *minimum = 0;
+    return readValue(monitor, 0x12, current, maximum);
+}
+
+BOOL
+SetMonitorContrast(HANDLE monitor, DWORD contrast)
+{
+    return writeValue(monitor, 0x12, contrast);
+}
@@ -0,0 +1,83 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+/**
+ * Simulated monitors behind the fake Win32 API, for tests. Configured
+ * through the environment, read on every call, so ddccli run as a child
+ * process is set up the same way as in-process code:
+ *
+ *   FAKE_MONITORS         number of monitors (default 2, at most 16)
+ *   FAKE_LATENCY_MS       time each DDC/CI transaction takes (default 0)
+ *   FAKE_LATENCY_STEP_MS  extra latency per monitor index (default 0)
+ *   FAKE_FAILURE_PERCENT  chance of a transaction failing with a bad
+ *                         checksum, drawn from a fixed seed (default 0)
+ *   FAKE_WRITE_LOG        file each applied write is appended to, as
+ *                         "<monitor> <code> <value> <steady clock ns>"
+ *   FAKE_SHARED_DIR       directory through which separate processes share
+ *                         monitor values and named mutexes and mappings,
+ *                         for tests running several ddccli at once (read
+ *                         once per process)
+ *
+ * Every monitor lists the same capabilities, including the unnamed 0xE0,
+ * and starts with its values at 50 out of 100 (input 0x0f, power on).
+ */
+namespace fake {
+
+struct Write {
+    size_t monitor;
+    uint8_t code;
+    unsigned long value;
+    std::chrono::steady_clock::time_point appliedAt;
+};
+
+std::string
+deviceId(size_t monitor);
+
+// DDC/CI transactions a monitor has seen, including failed ones
+unsigned
+transactions(size_t monitor);
+
+// Transactions that started while another was in flight on the same
+// monitor. Any is a bus locking bug.
+unsigned
+overlaps();
+
+std::vector<Write>
+writes();
+
+// Forgets values, counters and writes, except values kept in
+// FAKE_SHARED_DIR
+void
+reset();
+
+} // namespace fake
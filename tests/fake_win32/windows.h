@@ -0,0 +1,162 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+/**
+ * Just enough of the Win32 API for ddccli to build and run on other systems
+ * against the simulated monitors in fake_backend.cpp, for tests. Types have
+ * their Windows sizes; only what ddccli uses is declared.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+using BOOL = int;
+using BYTE = uint8_t;
+using WORD = uint16_t;
+using DWORD = uint32_t;
+using LONG = int32_t;
+using CHAR = char;
+
+using LPSTR = char*;
+using LPCSTR = const char*;
+using LPDWORD = DWORD*;
+using LPARAM = intptr_t;
+using SIZE_T = size_t;
+
+using HANDLE = void*;
+using HMONITOR = struct HMONITOR__*;
+using HDC = struct HDC__*;
+using LPSECURITY_ATTRIBUTES = void*;
+
+#define TRUE 1
+#define FALSE 0
+#define WINAPI
+#define CALLBACK
+
+#define MAX_PATH 260
+#define INFINITE 0xFFFFFFFF
+#define INVALID_HANDLE_VALUE (reinterpret_cast<HANDLE>(intptr_t(-1)))
+
+#define WAIT_OBJECT_0 0x00000000L
+#define WAIT_ABANDONED 0x00000080L
+#define WAIT_TIMEOUT 0x00000102L
+#define WAIT_FAILED 0xFFFFFFFF
+
+#define PAGE_READWRITE 0x04
+#define FILE_MAP_ALL_ACCESS 0xF001F
+
+#define ERROR_SUCCESS 0L
+#define ERROR_INVALID_HANDLE 6L
+#define ERROR_NOT_SUPPORTED 50L
+#define ERROR_SEM_TIMEOUT 121L
+#define ERROR_TIMEOUT 1460L
+
+#define ERROR_GRAPHICS_I2C_NOT_SUPPORTED ((LONG)0xC0262580L)
+#define ERROR_GRAPHICS_I2C_DEVICE_DOES_NOT_EXIST ((LONG)0xC0262581L)
+#define ERROR_GRAPHICS_I2C_ERROR_TRANSMITTING_DATA ((LONG)0xC0262582L)
+#define ERROR_GRAPHICS_I2C_ERROR_RECEIVING_DATA ((LONG)0xC0262583L)
+#define ERROR_GRAPHICS_DDCCI_VCP_NOT_SUPPORTED ((LONG)0xC0262584L)
+#define ERROR_GRAPHICS_DDCCI_INVALID_DATA ((LONG)0xC0262585L)
+#define ERROR_GRAPHICS_DDCCI_MONITOR_RETURNED_INVALID_TIMING_STATUS_BYTE       \
+    ((LONG)0xC0262586L)
+#define ERROR_GRAPHICS_MCA_INVALID_CAPABILITIES_STRING ((LONG)0xC0262587L)
+#define ERROR_GRAPHICS_DDCCI_INVALID_MESSAGE_COMMAND ((LONG)0xC0262589L)
+#define ERROR_GRAPHICS_DDCCI_INVALID_MESSAGE_LENGTH ((LONG)0xC026258AL)
+#define ERROR_GRAPHICS_DDCCI_INVALID_MESSAGE_CHECKSUM ((LONG)0xC026258BL)
+#define ERROR_GRAPHICS_INVALID_PHYSICAL_MONITOR_HANDLE ((LONG)0xC026258CL)
+#define ERROR_GRAPHICS_MONITOR_NO_LONGER_EXISTS ((LONG)0xC026258DL)
+
+DWORD
+GetLastError();
+
+void
+SetLastError(DWORD error);
+
+DWORD
+GetTickCount();
+
+DWORD
+GetCurrentProcessId();
+
+void
+Sleep(DWORD milliseconds);
+
+DWORD
+GetEnvironmentVariableA(LPCSTR name, LPSTR buffer, DWORD size);
+
+BOOL
+CloseHandle(HANDLE object);
+
+DWORD
+WaitForSingleObject(HANDLE object, DWORD milliseconds);
+
+// Named objects are shared within the process only
+HANDLE
+CreateMutexA(LPSECURITY_ATTRIBUTES attributes, BOOL initialOwner, LPCSTR name);
+
+BOOL
+ReleaseMutex(HANDLE mutex);
+
+HANDLE
+CreateEventA(LPSECURITY_ATTRIBUTES attributes,
+             BOOL manualReset,
+             BOOL initialState,
+             LPCSTR name);
+
+BOOL
+SetEvent(HANDLE event);
+
+HANDLE
+CreateFileMappingA(HANDLE file,
+                   LPSECURITY_ATTRIBUTES attributes,
+                   DWORD protect,
+                   DWORD sizeHigh,
+                   DWORD sizeLow,
+                   LPCSTR name);
+
+void*
+MapViewOfFile(HANDLE mapping,
+              DWORD access,
+              DWORD offsetHigh,
+              DWORD offsetLow,
+              SIZE_T size);
+
+BOOL
+UnmapViewOfFile(const void* view);
+
+LONG
+InterlockedIncrement(volatile LONG* target);
+
+LONG
+InterlockedExchange(volatile LONG* target, LONG value);
+
+LONG
+InterlockedExchangeAdd(volatile LONG* target, LONG value);
+
+LONG
+InterlockedCompareExchange(volatile LONG* target, LONG exchange, LONG compare);
+
+#include "winuser.h"
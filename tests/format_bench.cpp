@@ -0,0 +1,119 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "capabilities.h"
+#include "capabilities_corpus.h"
+
+#include <json.hpp>
+
+using json = nlohmann::json;
+
+
+/**
+ * Cost of encoding and decoding a --capabilities -j document for every
+ * corpus monitor, plus a monitor list and VCP values, as text JSON, CBOR and
+ * MessagePack.
+ *
+ * Usage: format_bench [rounds], one round encoding or decoding the document
+ * once.
+ */
+int
+main(int argc, char** argv)
+{
+    size_t rounds = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000;
+
+    json document;
+    size_t index = 0;
+    for (auto const& raw : capabilitiesCorpus) {
+        auto id = "monitor" + std::to_string(index++);
+        document["capabilities"][id] = parseCapabilities(std::string(raw));
+        document["monitorList"].push_back(id);
+        document["vcp"][id] = { { "code", 16 },
+                                { "maximum", 100 },
+                                { "name", "brightness" },
+                                { "value", 50 } };
+    }
+
+    // Kept live so the work can't be optimised away
+    size_t checksum = 0;
+
+    auto measure = [&](const char* name, auto encode, auto decode) {
+        auto encoded = encode(document);
+        if (decode(encoded) != document) {
+            std::cerr << name << ": round trip changed the document"
+                      << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t round = 0; round < rounds; round++) {
+            checksum += encode(document).size();
+        }
+        std::chrono::duration<double> encoding =
+          std::chrono::steady_clock::now() - start;
+
+        start = std::chrono::steady_clock::now();
+        for (size_t round = 0; round < rounds; round++) {
+            checksum += decode(encoded).size();
+        }
+        std::chrono::duration<double> decoding =
+          std::chrono::steady_clock::now() - start;
+
+        auto perDocument = [&](std::chrono::duration<double> elapsed) {
+            return elapsed.count() * 1e6 / static_cast<double>(rounds);
+        };
+
+        std::cout << name << ": " << encoded.size() << " bytes, encode "
+                  << perDocument(encoding) << " us, decode "
+                  << perDocument(decoding) << " us" << std::endl;
+    };
+
+    measure(
+      "json",
+      [](const json& j) { return j.dump(); },
+      [](const std::string& text) { return json::parse(text); });
+
+    measure(
+      "cbor",
+      [](const json& j) { return json::to_cbor(j); },
+      [](const std::vector<uint8_t>& bytes) { return json::from_cbor(bytes); });
+
+    measure(
+      "msgpack",
+      [](const json& j) { return json::to_msgpack(j); },
+      [](const std::vector<uint8_t>& bytes) {
+          return json::from_msgpack(bytes);
+      });
+
+    std::cout << "checksum " << checksum << std::endl;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,187 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <optional>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "capabilities.h"
+#include "capabilities_corpus.h"
+#include "json_writer.h"
+
+#include <json.hpp>
+
+using json = nlohmann::json;
+
+
+namespace {
+
+std::atomic<size_t> allocations{ 0 };
+
+using Clock = std::chrono::steady_clock;
+
+// Discards output, noting when it was first flushed: output only reaches a
+// reader of stdout then
+class TimingBuffer : public std::streambuf {
+public:
+    std::optional<Clock::time_point> firstFlush;
+    size_t bytes = 0;
+
+protected:
+    int_type overflow(int_type ch) override
+    {
+        if (ch != traits_type::eof()) {
+            bytes++;
+        }
+        return ch;
+    }
+
+    std::streamsize xsputn(const char*, std::streamsize count) override
+    {
+        bytes += static_cast<size_t>(count);
+        return count;
+    }
+
+    int sync() override
+    {
+        if (!firstFlush && bytes > 0) {
+            firstFlush = Clock::now();
+        }
+        return 0;
+    }
+};
+
+} // namespace
+
+
+void*
+operator new(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (auto block = std::malloc(size ? size : 1)) {
+        return block;
+    }
+    throw std::bad_alloc();
+}
+
+void
+operator delete(void* block) noexcept
+{
+    std::free(block);
+}
+
+void
+operator delete(void* block, size_t) noexcept
+{
+    std::free(block);
+}
+
+
+/**
+ * Allocations and time to first byte for --capabilities -j output, written
+ * through JsonWriter and flushed as each monitor completes, and collected in
+ * a DOM that is dumped at the end. Each monitor takes a millisecond to
+ * answer; parsing is done beforehand, so only output allocates.
+ *
+ * Usage: json_output_bench [monitors]
+ */
+int
+main(int argc, char** argv)
+{
+    size_t monitors = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 64;
+
+    std::vector<std::string> ids;
+    for (size_t i = 0; i < monitors; i++) {
+        char id[96];
+        std::snprintf(id,
+                      sizeof(id),
+                      "\\\\?\\DISPLAY#BEN%04zu#5&1a2b3c4d&0&UID%zu#"
+                      "{e6f07b5f-ee97-4a90-b076-33f57bf4eaa7}",
+                      i,
+                      i + 256);
+        ids.push_back(id);
+    }
+
+    std::vector<MonitorCapabilities> parsed;
+    for (size_t i = 0; i < monitors; i++) {
+        parsed.push_back(parseCapabilities(std::string(
+          capabilitiesCorpus[i % std::size(capabilitiesCorpus)])));
+    }
+
+    auto answer = [&](size_t i) -> const MonitorCapabilities& {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        return parsed[i];
+    };
+
+    auto measure = [&](const char* name, auto output) {
+        TimingBuffer buffer;
+        std::ostream out(&buffer);
+
+        auto before = allocations.load();
+        auto start = Clock::now();
+        output(out);
+        auto elapsed = Clock::now() - start;
+        auto allocated = allocations.load() - before;
+
+        std::chrono::duration<double, std::milli> ttfb =
+          *buffer.firstFlush - start;
+        std::chrono::duration<double, std::milli> total = elapsed;
+        std::cout << name << ": " << allocated << " allocations, "
+                  << ttfb.count() << " ms to first byte, " << total.count()
+                  << " ms, " << buffer.bytes << " bytes" << std::endl;
+    };
+
+    measure("dom", [&](std::ostream& out) {
+        json document;
+        document["capabilities"] = json::object();
+        for (size_t i = 0; i < monitors; i++) {
+            document["capabilities"][ids[i]] = answer(i);
+        }
+        out << document.dump() << '\n';
+        out.flush();
+    });
+
+    measure("stream", [&](std::ostream& out) {
+        JsonWriter writer(out);
+        writer.beginObject().key("capabilities").beginObject();
+        for (size_t i = 0; i < monitors; i++) {
+            writer.key(ids[i]).value(json(answer(i)));
+            out.flush();
+        }
+        writer.close();
+        out << '\n';
+        out.flush();
+    });
+
+    return EXIT_SUCCESS;
+}
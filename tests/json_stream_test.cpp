@@ -0,0 +1,121 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <json.hpp>
+
+#include "check.h"
+
+namespace fs = std::filesystem;
+using json = nlohmann::json;
+
+
+namespace {
+
+std::string
+run(const std::string& ddccli, const std::string& arguments)
+{
+    auto outputPath = fs::temp_directory_path() / "ddccli-json-stream.out";
+    auto command =
+      "\"" + ddccli + "\" " + arguments + " > " + outputPath.string();
+    CHECK(std::system(command.c_str()) == 0);
+
+    std::ifstream output(outputPath, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(output),
+                       std::istreambuf_iterator<char>());
+}
+
+// Timings differ from run to run, the rest must not
+json
+withoutTimings(json document)
+{
+    document.erase("latencyMs");
+    document.erase("lockWaitMs");
+    return document;
+}
+
+} // namespace
+
+
+// Streamed -j output must be what dumping the whole document gives, which is
+// what the binary formats still encode
+int
+main(int argc, char* argv[])
+{
+    CHECK(argc == 2);
+    std::string ddccli = argv[1];
+
+    setenv("FAKE_MONITORS", "4", 1);
+    setenv("FAKE_LATENCY_MS", "5", 1);
+
+    auto ids = json::parse(run(ddccli, "-l -j")).at("monitorList");
+    CHECK(ids.size() == 4);
+    auto selected = " -m '" + ids.at(2).get<std::string>() + "'";
+
+    std::vector<std::string> commands = {
+        "-l",
+        "-l -B" + selected,
+        "-l -B -C" + selected,
+        "--capabilities",
+        "-l --capabilities",
+        "-C --capabilities" + selected,
+        "-B -C --capabilities" + selected,
+        "--vcp brightness",
+        "-l --vcp brightness",
+        "--vcp brightness" + selected,
+        "-B --vcp contrast --capabilities" + selected,
+    };
+
+    // Nothing else runs and nothing fails, so no monitor waits or retries
+    auto alone = json::parse(run(ddccli, "-B -j" + selected));
+    CHECK(alone.count("lockWaitMs") == 0);
+    CHECK(alone.count("retries") == 0);
+
+    for (auto const& command : commands) {
+        // Capabilities are cached once read, which changes what a run
+        // reports, so both compared runs start from the cache filled here
+        run(ddccli, command + " -j");
+
+        auto streamed = run(ddccli, command + " -j");
+        auto collected = run(ddccli, command + " --format cbor");
+
+        // Already in key order: reading it back and dumping it again, which
+        // sorts keys, changes nothing
+        CHECK(!streamed.empty() && streamed.back() == '\n');
+        streamed.pop_back();
+        CHECK(json::parse(streamed).dump() == streamed);
+
+        auto decoded = json::from_cbor(collected);
+        CHECK(withoutTimings(json::parse(streamed)).dump()
+              == withoutTimings(decoded).dump());
+    }
+
+    return EXIT_SUCCESS;
+}
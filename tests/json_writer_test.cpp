@@ -0,0 +1,131 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include <cstdint>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+
+#include "check.h"
+#include "json_writer.h"
+
+#include <json.hpp>
+
+using json = nlohmann::json;
+
+
+namespace {
+
+// Keys are written in the order json sorts them, so dumps must match
+void
+matchesDump()
+{
+    std::string awkward = "quote\" backslash\\ newline\n tab\t ctl\x01 é";
+
+    std::ostringstream out;
+    JsonWriter writer(out);
+    writer.beginObject()
+      .key("array")
+      .beginArray()
+      .value(-5)
+      .value(uint8_t(200))
+      .value(true)
+      .value("text")
+      .beginObject()
+      .endObject()
+      .beginArray()
+      .endArray()
+      .endArray()
+      .key("fragment")
+      .value(json({ { "b", 2 }, { "a", { 1, 2 } } }))
+      .key("nested")
+      .beginObject()
+      .key("code")
+      .value(uint16_t(0x10))
+      .key("name")
+      .value(std::string("brightness"))
+      .endObject()
+      .key(awkward)
+      .value(awkward)
+      .endObject();
+
+    json expected = {
+        { "array", { -5, 200, true, "text", json::object(), json::array() } },
+        { "fragment", { { "a", { 1, 2 } }, { "b", 2 } } },
+        { "nested", { { "code", 16 }, { "name", "brightness" } } },
+        { awkward, awkward },
+    };
+
+    CHECK(out.str() == expected.dump());
+    CHECK(writer.depth() == 0);
+}
+
+void
+closesOpenScopes()
+{
+    std::ostringstream out;
+    JsonWriter writer(out);
+    writer.beginObject().key("list").beginArray().value(1);
+    CHECK(writer.depth() == 2);
+
+    writer.close();
+    CHECK(writer.depth() == 0);
+    CHECK(out.str() == R"({"list":[1]})");
+}
+
+// Members arriving out of order come out as the DOM would sort them
+void
+ordersMembers()
+{
+    std::ostringstream out;
+    JsonWriter writer(out);
+    writer.beginObject();
+
+    OrderedMembers members(writer, { "a", "b", "c", "d" });
+    members.write("c", json({ { "raw", "(c)" } }));
+    CHECK(out.str() == "{");
+
+    members.drop("b");
+    members.write("d", 4);
+    CHECK(out.str() == "{");
+
+    members.write("a", 1);
+    writer.endObject();
+
+    json expected = { { "a", 1 }, { "c", { { "raw", "(c)" } } }, { "d", 4 } };
+    CHECK(out.str() == expected.dump());
+}
+
+} // namespace
+
+
+int
+main()
+{
+    matchesDump();
+    closesOpenScopes();
+    ordersMembers();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,149 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "output_buffer.h"
+
+
+namespace {
+
+/**
+ * Stands in for stdout redirected to a pipe: fully buffered in BUFSIZ
+ * blocks and flushed by std::endl, each flush one write(2) to /dev/null.
+ */
+class CountingFileBuffer : public std::streambuf {
+public:
+    size_t writes = 0;
+
+    CountingFileBuffer()
+      : fd(open("/dev/null", O_WRONLY))
+      , block(BUFSIZ)
+    {
+        setp(block.data(), block.data() + block.size());
+    }
+
+    ~CountingFileBuffer() override { close(fd); }
+
+protected:
+    int_type overflow(int_type ch) override
+    {
+        flush();
+        if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(ch);
+            pbump(1);
+        }
+        return traits_type::not_eof(ch);
+    }
+
+    int sync() override
+    {
+        flush();
+        return 0;
+    }
+
+private:
+    void flush()
+    {
+        if (pptr() > pbase()) {
+            writes++;
+            if (write(fd, pbase(), static_cast<size_t>(pptr() - pbase()))
+                < 0) {
+                std::perror("write");
+                std::exit(EXIT_FAILURE);
+            }
+        }
+        setp(block.data(), block.data() + block.size());
+    }
+
+    int fd;
+    std::vector<char> block;
+};
+
+} // namespace
+
+
+/**
+ * write(2) calls and time for listing monitors one per line, flushing each
+ * line with std::endl as before and through an OutputBuffer flushed once at
+ * the end.
+ *
+ * Usage: output_bench [monitors]
+ */
+int
+main(int argc, char** argv)
+{
+    size_t monitors = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000;
+
+    std::vector<std::string> ids;
+    for (size_t i = 0; i < monitors; i++) {
+        char id[96];
+        std::snprintf(id,
+                      sizeof(id),
+                      "\\\\?\\DISPLAY#BEN%04zu#5&1a2b3c4d&0&UID%zu#"
+                      "{e6f07b5f-ee97-4a90-b076-33f57bf4eaa7}",
+                      i,
+                      i + 256);
+        ids.push_back(id);
+    }
+
+    auto measure = [&](const char* name, auto list) {
+        CountingFileBuffer file;
+        std::ostream out(&file);
+
+        auto start = std::chrono::steady_clock::now();
+        list(out);
+        std::chrono::duration<double, std::milli> elapsed =
+          std::chrono::steady_clock::now() - start;
+
+        std::cout << name << ": " << file.writes << " writes, "
+                  << elapsed.count() << " ms" << std::endl;
+    };
+
+    measure("endl", [&](std::ostream& out) {
+        for (auto const& id : ids) {
+            out << id << std::endl;
+        }
+    });
+
+    measure("buffered", [&](std::ostream& out) {
+        OutputBuffer buffer(out);
+        for (auto const& id : ids) {
+            out << id << '\n';
+        }
+        out.flush();
+    });
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,100 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include <json.hpp>
+
+#include "check.h"
+#include "circuit_breaker.h"
+
+namespace fs = std::filesystem;
+using json = nlohmann::json;
+
+
+namespace {
+
+struct Run {
+    int status;
+    std::string output;
+};
+
+Run
+run(const std::string& ddccli, const std::string& arguments)
+{
+    auto outputPath = fs::temp_directory_path() / "ddccli-quarantine.out";
+    auto command =
+      "\"" + ddccli + "\" " + arguments + " > " + outputPath.string();
+
+    Run result;
+    result.status = std::system(command.c_str());
+
+    std::ifstream output(outputPath);
+    result.output.assign(std::istreambuf_iterator<char>(output),
+                         std::istreambuf_iterator<char>());
+    return result;
+}
+
+} // namespace
+
+
+// Reads of a monitor that always fails must trip its breaker even though
+// each run ends in an error, and a quarantined selected monitor is then
+// reported as skipped instead of missing
+int
+main(int argc, char* argv[])
+{
+    CHECK(argc == 2);
+    std::string ddccli = argv[1];
+
+    auto state = fs::path(std::getenv("LOCALAPPDATA")) / "ddccli";
+    fs::remove_all(state);
+
+    setenv("FAKE_MONITORS", "1", 1);
+    auto id = run(ddccli, "-l").output;
+    CHECK(!id.empty());
+    id.pop_back();
+
+    setenv("FAKE_FAILURE_PERCENT", "100", 1);
+    auto read = "-j --retry read=1 -B -m '" + id + "'";
+
+    for (unsigned i = 0; i < CircuitBreaker::failureThreshold; i++) {
+        CHECK(run(ddccli, read).status != 0);
+    }
+
+    CHECK(fs::exists(state / "breakers.json"));
+
+    auto skipped = run(ddccli, read);
+    CHECK(skipped.status == 0);
+
+    auto output = json::parse(skipped.output);
+    CHECK(output.at("skipped").at(id).at("reason") == "quarantined");
+    CHECK(output.count("brightness") == 0);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,128 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <thread>
+
+#include "rate_controller.h"
+#include "result.h"
+
+using namespace std::chrono_literals;
+
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * A monitor that stops coping when commands come too close together: every
+ * command after a gap of 50ms fails, and the failure rate falls linearly
+ * to none at a gap of 200ms.
+ */
+class CongestedMonitor {
+public:
+    Result<unsigned long> command()
+    {
+        std::this_thread::sleep_for(latency);
+
+        auto now = Clock::now();
+        std::chrono::duration<double, std::milli> gap = now - lastCompletion;
+        lastCompletion = now;
+
+        double failureRate =
+          std::clamp((200.0 - gap.count()) / 150.0, 0.0, 1.0);
+        if (std::bernoulli_distribution(failureRate)(random)) {
+            return DdcError{ DdcErrorCode::Checksum, "checksum mismatch" };
+        }
+
+        return 50ul;
+    }
+
+private:
+    static constexpr std::chrono::milliseconds latency{ 10 };
+
+    Clock::time_point lastCompletion;
+    std::mt19937 random{ 1 };
+};
+
+void
+report(const char* name, size_t succeeded, size_t failed, double seconds)
+{
+    std::cout << name << ": " << static_cast<double>(succeeded) / seconds
+              << " commands/s goodput, " << failed << " of "
+              << succeeded + failed << " failed" << std::endl;
+}
+
+} // namespace
+
+
+/**
+ * Goodput of a stream of commands to a simulated monitor whose error rate
+ * rises with command rate, sent at the fixed DDC/CI maximum and paced by
+ * BusRateController's AIMD.
+ *
+ * Usage: rate_bench [seconds per run]
+ */
+int
+main(int argc, char** argv)
+{
+    double seconds = argc > 1 ? std::strtod(argv[1], nullptr) : 5.0;
+    auto duration = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(seconds));
+
+    {
+        CongestedMonitor monitor;
+        size_t succeeded = 0, failed = 0;
+
+        for (auto end = Clock::now() + duration; Clock::now() < end;) {
+            auto result = monitor.command();
+            (result ? succeeded : failed)++;
+            std::this_thread::sleep_for(ddcInterMessageDelay);
+        }
+
+        report("fixed", succeeded, failed, seconds);
+    }
+
+    {
+        CongestedMonitor monitor;
+        BusRateController controller;
+        size_t succeeded = 0, failed = 0;
+
+        for (auto end = Clock::now() + duration; Clock::now() < end;) {
+            auto result =
+              pacedTransaction(controller, [&] { return monitor.command(); });
+            (result ? succeeded : failed)++;
+        }
+
+        report("aimd", succeeded, failed, seconds);
+        std::cout << "final rate " << controller.rate() << " commands/s"
+                  << std::endl;
+    }
+
+    return EXIT_SUCCESS;
+}
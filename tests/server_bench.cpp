@@ -0,0 +1,146 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <json.hpp>
+
+#include "bus_lock.h"
+#include "monitor.h"
+#include "rate_controller.h"
+#include "server.h"
+
+using json = nlohmann::json;
+
+
+namespace {
+
+constexpr size_t monitors = 16;
+
+struct Request {
+    std::string monitor;
+    unsigned long value;
+};
+
+void
+report(const char* name,
+       size_t requests,
+       size_t failed,
+       std::chrono::duration<double> elapsed)
+{
+    std::cout << name << ": "
+              << static_cast<double>(requests) / elapsed.count()
+              << " requests/s, " << failed << " failed" << std::endl;
+}
+
+} // namespace
+
+
+/**
+ * Throughput of --serve against simulated monitors, with requests for every
+ * monitor interleaved as many clients would send them, and of the same writes
+ * made one after another on one thread as before the per-monitor workers.
+ * Writes are never shared between requests, so both make every transaction.
+ *
+ * Usage: server_bench [requests per monitor]. The monitors' latency is
+ * FAKE_LATENCY_MS, 40ms unless set.
+ */
+int
+main(int argc, char** argv)
+{
+    size_t perMonitor = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 8;
+
+    setenv("FAKE_MONITORS", std::to_string(monitors).c_str(), 1);
+    setenv("FAKE_LATENCY_MS", "40", 0);
+    populateHandlesMap();
+
+    std::vector<Request> requests;
+    for (size_t round = 0; round < perMonitor; round++) {
+        for (auto const& [ id, handle ] : handles) {
+            requests.push_back({ id, 10 + round % 80 });
+        }
+    }
+
+    auto code = parseVcpCode("brightness");
+
+    {
+        std::map<std::string, std::unique_ptr<BusLock>> locks;
+        for (auto const& [ id, handle ] : handles) {
+            locks[id] = std::make_unique<BusLock>(id);
+        }
+
+        size_t failed = 0;
+        auto start = std::chrono::steady_clock::now();
+
+        for (auto const& request : requests) {
+            ScopedBusLock lock(*locks.at(request.monitor));
+            auto written =
+              pacedTransaction(busRateController(request.monitor), [&] {
+                  return trySetVcpFeature(
+                    handles.at(request.monitor), code, request.value);
+              });
+            failed += !written;
+        }
+
+        report("serial",
+               requests.size(),
+               failed,
+               std::chrono::steady_clock::now() - start);
+    }
+
+    {
+        std::string lines;
+        for (size_t i = 0; i < requests.size(); i++) {
+            json request = { { "id", i },
+                             { "monitor", requests[i].monitor },
+                             { "vcp", "brightness" },
+                             { "value", requests[i].value } };
+            lines += request.dump() + "\n";
+        }
+
+        std::istringstream in(lines);
+        std::ostringstream out;
+        auto start = std::chrono::steady_clock::now();
+        runServer(in, out);
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        size_t failed = 0;
+        std::istringstream responses(out.str());
+        std::string line;
+        while (std::getline(responses, line)) {
+            failed += json::parse(line).count("error");
+        }
+
+        report("server", requests.size(), failed, elapsed);
+    }
+
+    return EXIT_SUCCESS;
+}
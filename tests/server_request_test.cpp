@@ -0,0 +1,169 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include <chrono>
+#include <cstdlib>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <json.hpp>
+
+#include "check.h"
+#include "fake_backend.h"
+#include "monitor.h"
+#include "retry.h"
+#include "server.h"
+#include "value_store.h"
+
+using json = nlohmann::json;
+
+
+namespace {
+
+std::map<int, json>
+serve(const std::vector<json>& requests)
+{
+    std::string lines;
+    for (auto const& request : requests) {
+        lines += request.dump() + "\n";
+    }
+
+    std::istringstream in(lines);
+    std::ostringstream out;
+    CHECK(runServer(in, out) == EXIT_SUCCESS);
+
+    std::map<int, json> responses;
+    std::istringstream responseLines(out.str());
+    std::string line;
+    while (std::getline(responseLines, line)) {
+        auto response = json::parse(line);
+        responses.emplace(response.at("id").get<int>(), std::move(response));
+    }
+
+    CHECK(responses.size() == requests.size());
+    return responses;
+}
+
+json
+request(int id, json vcp)
+{
+    return { { "id", id }, { "monitor", fake::deviceId(0) }, { "vcp", vcp } };
+}
+
+json
+request(int id, json vcp, json value)
+{
+    auto command = request(id, vcp);
+    command["value"] = value;
+    return command;
+}
+
+// A number is the code itself, as in responses, and never hex digits
+void
+numericCodes()
+{
+    fake::reset();
+
+    auto responses = serve({ request(1, 16), request(2, 96) });
+    CHECK(responses[1].at("vcp") == "brightness");
+    CHECK(responses[1].at("value") == 50);
+    CHECK(responses[2].at("vcp") == "input");
+    CHECK(responses[2].at("value") == 0x0f);
+}
+
+// Unnamed codes come back as numbers, which are accepted as requests
+void
+responsesRoundTrip()
+{
+    fake::reset();
+
+    auto read = serve({ request(1, "e0") })[1];
+    CHECK(read.at("vcp") == 0xe0);
+
+    auto responses = serve({ request(2, read.at("vcp"), 60),
+                             request(3, read.at("vcp")) });
+    CHECK(responses[2].count("error") == 0);
+    CHECK(responses[3].at("value") == 60);
+}
+
+void
+rejectsOutOfRange()
+{
+    fake::reset();
+
+    auto responses = serve({ request(1, -1),
+                             request(2, 256),
+                             request(3, 16.5),
+                             request(4, 16, -5),
+                             request(5, 16, 65536),
+                             request(6, 16, 2.5) });
+
+    for (int id : { 1, 2, 3 }) {
+        CHECK(responses[id].at("error") == "vcp code out of range");
+    }
+
+    for (int id : { 4, 5, 6 }) {
+        CHECK(responses[id].at("error") == "vcp value out of range");
+    }
+
+    CHECK(fake::transactions(0) == 0);
+}
+
+// So --max-age reads elsewhere don't serve a value the server replaced
+void
+writesUpdateTheStore()
+{
+    fake::reset();
+
+    ValueStore store;
+    std::istringstream in(request(1, "brightness", 70).dump() + "\n");
+    std::ostringstream out;
+    CHECK(runServer(
+            in, out, OutputFormat::Json, defaultRetryPolicies, &store)
+          == EXIT_SUCCESS);
+
+    // As another process would load it
+    auto saved =
+      ValueStore().get(fake::deviceId(0), 0x10, std::chrono::minutes(1));
+    CHECK(saved && saved->currentValue == 70);
+}
+
+} // namespace
+
+
+int
+main()
+{
+    setenv("FAKE_MONITORS", "1", 1);
+    populateHandlesMap();
+
+    numericCodes();
+    responsesRoundTrip();
+    rejectsOutOfRange();
+    writesUpdateTheStore();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,136 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include <chrono>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+
+#include <json.hpp>
+
+#include "check.h"
+#include "fake_backend.h"
+#include "monitor.h"
+#include "retry.h"
+#include "server.h"
+
+using json = nlohmann::json;
+using namespace std::chrono_literals;
+
+
+namespace {
+
+// Few, since failures slow the bus pacing down to a handful of commands a
+// second
+constexpr int requests = 10;
+
+struct Outcome {
+    int failed = 0;
+    int retried = 0;
+};
+
+// Writes, which are never shared, so each request is its own transaction
+Outcome
+serveWrites(const RetryPolicies& policies)
+{
+    fake::reset();
+    auto monitor = fake::deviceId(0);
+
+    std::string lines;
+    for (int id = 0; id < requests; id++) {
+        json request = { { "id", id },
+                         { "monitor", monitor },
+                         { "vcp", "brightness" },
+                         { "value", id } };
+        lines += request.dump() + "\n";
+    }
+
+    std::istringstream in(lines);
+    std::ostringstream out;
+    CHECK(runServer(in, out, OutputFormat::Json, policies) == EXIT_SUCCESS);
+
+    Outcome outcome;
+    int responses = 0;
+    std::istringstream responseLines(out.str());
+    std::string line;
+    while (std::getline(responseLines, line)) {
+        auto response = json::parse(line);
+        responses++;
+
+        if (response.count("error")) {
+            CHECK(response.at("errorCode") == "checksum");
+            outcome.failed++;
+        }
+
+        if (response.count("retries")) {
+            outcome.retried++;
+        }
+    }
+
+    CHECK(responses == requests);
+    CHECK(fake::overlaps() == 0);
+    return outcome;
+}
+
+// Enough attempts ride out every injected failure
+void
+retriesWithinPolicy()
+{
+    auto policies = defaultRetryPolicies;
+    policies.write = { 12, 1ms, 2ms, 10s };
+
+    auto outcome = serveWrites(policies);
+    CHECK(outcome.failed == 0);
+    CHECK(outcome.retried > 0);
+}
+
+// A single attempt surfaces them instead
+void
+singleAttemptFails()
+{
+    auto policies = defaultRetryPolicies;
+    policies.write = { 1, 1ms, 2ms, 10s };
+
+    auto outcome = serveWrites(policies);
+    CHECK(outcome.failed > 0);
+    CHECK(outcome.retried == 0);
+    // A read of the maximum, then the write, both at most once
+    CHECK(fake::transactions(0) <= 2 * requests);
+}
+
+} // namespace
+
+
+int
+main()
+{
+    setenv("FAKE_MONITORS", "1", 1);
+    setenv("FAKE_FAILURE_PERCENT", "25", 1);
+    populateHandlesMap();
+
+    retriesWithinPolicy();
+    singleAttemptFails();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,203 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include <condition_variable>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <json.hpp>
+
+#include "check.h"
+#include "fake_backend.h"
+#include "monitor.h"
+#include "server.h"
+
+using json = nlohmann::json;
+
+
+namespace {
+
+/**
+ * Request stream fed by any number of client threads. Reads block until a
+ * client sends more or the feed is closed, like stdin of a long-running
+ * server.
+ */
+class RequestFeed : public std::streambuf {
+public:
+    void send(const std::string& line)
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        queued += line;
+        queued += '\n';
+        available.notify_one();
+    }
+
+    void close()
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        closed = true;
+        available.notify_one();
+    }
+
+protected:
+    int_type underflow() override
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        available.wait(lock, [&] { return !queued.empty() || closed; });
+
+        if (queued.empty()) {
+            return traits_type::eof();
+        }
+
+        current.swap(queued);
+        queued.clear();
+        setg(current.data(), current.data(), current.data() + current.size());
+        return traits_type::to_int_type(current.front());
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable available;
+    std::string queued;
+    std::string current;
+    bool closed = false;
+};
+
+std::map<int, json>
+responsesById(const std::string& output)
+{
+    std::map<int, json> responses;
+    std::istringstream lines(output);
+    std::string line;
+    while (std::getline(lines, line)) {
+        auto response = json::parse(line);
+        int id = response.at("id").get<int>();
+        CHECK(responses.count(id) == 0);
+        responses.emplace(id, std::move(response));
+    }
+
+    return responses;
+}
+
+json
+request(int id, const std::string& monitor, const char* vcp)
+{
+    return { { "id", id }, { "monitor", monitor }, { "vcp", vcp } };
+}
+
+// Concurrent identical reads must share transactions, never overlap on
+// the bus, and each still get exactly one response
+void
+concurrentReadsShareTransactions()
+{
+    constexpr int clients = 16;
+    constexpr int readsPerClient = 25;
+    constexpr int requests = clients * readsPerClient;
+
+    fake::reset();
+    auto monitor = fake::deviceId(0);
+
+    RequestFeed feed;
+    std::istream in(&feed);
+    std::ostringstream out;
+    std::thread server([&] { runServer(in, out); });
+
+    std::vector<std::thread> threads;
+    for (int client = 0; client < clients; client++) {
+        threads.emplace_back([&, client] {
+            for (int i = 0; i < readsPerClient; i++) {
+                int id = client * readsPerClient + i;
+                feed.send(request(id, monitor, "brightness").dump());
+            }
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    feed.close();
+    server.join();
+
+    auto responses = responsesById(out.str());
+    CHECK(responses.size() == requests);
+    for (auto const& [ id, response ] : responses) {
+        CHECK(response.at("value") == 50);
+        CHECK(response.count("error") == 0);
+    }
+
+    CHECK(fake::transactions(0) > 0);
+    CHECK(fake::transactions(0) < requests / 4);
+    CHECK(fake::overlaps() == 0);
+}
+
+// A queued write ends the sharing, so later reads see the new value
+void
+writesAreNotSharedAcross()
+{
+    fake::reset();
+    auto monitor = fake::deviceId(0);
+
+    auto write = request(3, monitor, "brightness");
+    write["value"] = 70;
+
+    std::istringstream in(request(1, monitor, "brightness").dump() + "\n"
+                          + request(2, monitor, "brightness").dump() + "\n"
+                          + write.dump() + "\n"
+                          + request(4, monitor, "brightness").dump() + "\n"
+                          + request(5, monitor, "brightness").dump() + "\n");
+    std::ostringstream out;
+    CHECK(runServer(in, out) == EXIT_SUCCESS);
+
+    auto responses = responsesById(out.str());
+    CHECK(responses.size() == 5);
+    CHECK(responses[1].at("value") == 50);
+    CHECK(responses[2].at("value") == 50);
+    CHECK(responses[3].count("error") == 0);
+    CHECK(responses[4].at("value") == 70);
+    CHECK(responses[5].at("value") == 70);
+    CHECK(fake::overlaps() == 0);
+}
+
+} // namespace
+
+
+int
+main()
+{
+    setenv("FAKE_MONITORS", "1", 1);
+    setenv("FAKE_LATENCY_MS", "20", 1);
+    populateHandlesMap();
+
+    concurrentReadsShareTransactions();
+    writesAreNotSharedAcross();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,113 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+
+#include "capabilities.h"
+#include "check.h"
+#include "snapshot.h"
+
+
+// Alongside SnapshotValue, so comparing vectors of them finds it
+static bool
+operator==(const SnapshotValue& a, const SnapshotValue& b)
+{
+    return a.code == b.code && a.value == b.value;
+}
+
+
+namespace {
+
+void
+roundTrips()
+{
+    Snapshot snapshot = {
+        { "00000000000000ff", {} },
+        { "0123456789abcdef", { { 0x10, 40 }, { 0x60, 0x0f } } },
+        { "ffffffffffffffff", { { 0x14, 0xffff } } },
+    };
+
+    auto encoded = encodeSnapshot(snapshot);
+
+    // Header, then 9 bytes per monitor and 3 per value
+    CHECK(encoded.size() == 7 + 3 * 9 + 3 * 3);
+    CHECK(encoded.compare(0, 4, "DDCS") == 0);
+
+    auto decoded = decodeSnapshot(encoded);
+    CHECK(decoded.size() == snapshot.size());
+    for (auto const& [ key, values ] : snapshot) {
+        CHECK(decoded.count(key));
+        CHECK(decoded[key] == values);
+    }
+}
+
+void
+rejectsBadData()
+{
+    auto encoded = encodeSnapshot({ { "0123456789abcdef", { { 0x10, 40 } } } });
+
+    CHECK_THROWS(decodeSnapshot(""));
+    CHECK_THROWS(decodeSnapshot("DDCX" + encoded.substr(4)));
+    CHECK_THROWS(decodeSnapshot(encoded.substr(0, encoded.size() - 1)));
+    CHECK_THROWS(decodeSnapshot(encoded + '\0'));
+
+    auto future = encoded;
+    future[4] = 2;
+    CHECK_THROWS(decodeSnapshot(future));
+}
+
+void
+savesOnlySettings()
+{
+    auto capabilities = parseCapabilities(
+      "(prot(monitor)vcp(02 04 10 12 1E 60(0F 11) 73 74 AC D6(01 04)))");
+
+    auto codes = snapshotCodes(capabilities);
+    auto saved = [&](uint8_t code) {
+        return std::find(codes.begin(), codes.end(), code) != codes.end();
+    };
+
+    CHECK(saved(0x10) && saved(0x12) && saved(0x60));
+
+    // Action (new-control-value, auto-setup, power), reset, table and
+    // read-only codes
+    for (uint8_t code : { 0x02, 0x1e, 0xd6, 0x04, 0x74, 0x73, 0xac }) {
+        CHECK(!saved(code));
+    }
+}
+
+} // namespace
+
+
+int
+main()
+{
+    roundTrips();
+    rejectsBadData();
+    savesOnlySettings();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,96 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "check.h"
+#include "spsc_queue.h"
+
+
+namespace {
+
+void
+keepsOrderAndCapacity()
+{
+    SpscQueue<std::string, 4> queue;
+    CHECK(queue.empty());
+    CHECK(!queue.tryPop());
+
+    for (int i = 0; i < 4; i++) {
+        CHECK(queue.tryPush(std::to_string(i)));
+    }
+    CHECK(!queue.tryPush("full"));
+
+    CHECK(queue.tryPop() == "0");
+    CHECK(queue.tryPush("4"));
+
+    for (int i = 1; i <= 4; i++) {
+        CHECK(queue.tryPop() == std::to_string(i));
+    }
+    CHECK(queue.empty());
+}
+
+void
+transfersBetweenThreads()
+{
+    constexpr size_t count = 1000000;
+
+    // Too big for the stack once padded
+    auto queue = std::make_unique<SpscQueue<size_t, 256>>();
+
+    std::thread producer([&] {
+        for (size_t i = 0; i < count; i++) {
+            while (!queue->tryPush(i)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    for (size_t expected = 0; expected < count;) {
+        if (auto value = queue->tryPop()) {
+            CHECK(*value == expected);
+            expected++;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    producer.join();
+    CHECK(queue->empty());
+}
+
+} // namespace
+
+
+int
+main()
+{
+    keepsOrderAndCapacity();
+    transfersBetweenThreads();
+
+    return EXIT_SUCCESS;
+}
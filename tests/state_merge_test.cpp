@@ -0,0 +1,99 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include <json.hpp>
+
+#include "check.h"
+#include "fake_backend.h"
+
+namespace fs = std::filesystem;
+using json = nlohmann::json;
+
+
+namespace {
+
+constexpr size_t monitors = 16;
+
+// Runs one ddccli per monitor, all at once, each adding its own entry to
+// the state files
+void
+runConcurrently(const std::string& ddccli, const std::string& arguments)
+{
+    std::string command;
+    for (size_t i = 0; i < monitors; i++) {
+        command += "\"" + ddccli + "\" " + arguments + " -m '"
+                   + fake::deviceId(i) + "' > /dev/null 2>&1 & ";
+    }
+
+    command += "wait";
+    CHECK(std::system(command.c_str()) == 0);
+}
+
+size_t
+entries(const fs::path& path)
+{
+    std::ifstream file(path);
+    CHECK(file);
+    return json::parse(file).size();
+}
+
+} // namespace
+
+
+// Concurrent processes merging into the value store and breaker state must
+// not lose each other's entries
+int
+main(int argc, char* argv[])
+{
+    CHECK(argc == 2);
+    std::string ddccli = argv[1];
+
+    auto state = fs::path(std::getenv("LOCALAPPDATA")) / "ddccli";
+    auto shared = fs::path(std::getenv("LOCALAPPDATA")) / "shared";
+
+    for (int round = 0; round < 3; round++) {
+        fs::remove_all(state);
+        fs::remove_all(shared);
+        fs::create_directories(shared);
+
+        setenv("FAKE_MONITORS", std::to_string(monitors).c_str(), 1);
+        setenv("FAKE_SHARED_DIR", shared.c_str(), 1);
+        unsetenv("FAKE_FAILURE_PERCENT");
+
+        runConcurrently(ddccli, "-b 40");
+        CHECK(entries(state / "values.json") == monitors);
+
+        // Every read fails, so each process records a failure
+        setenv("FAKE_FAILURE_PERCENT", "100", 1);
+        runConcurrently(ddccli, "-B --retry read=1");
+        CHECK(entries(state / "breakers.json") == monitors);
+    }
+
+    return EXIT_SUCCESS;
+}
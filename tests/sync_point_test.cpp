@@ -0,0 +1,123 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "check.h"
+#include "sync_point.h"
+
+using namespace std::chrono_literals;
+
+
+namespace {
+
+void
+releasesTogether()
+{
+    constexpr int participants = 4;
+
+    SyncPoint point(participants);
+    std::vector<SyncPoint::Clock::time_point> released(participants);
+    std::vector<std::thread> threads;
+
+    auto start = SyncPoint::Clock::now();
+    for (int i = 0; i < participants; i++) {
+        threads.emplace_back([&, i] {
+            // Staggered preparation, as with monitors of different latency
+            std::this_thread::sleep_for(i * 20ms);
+
+            SyncParticipant sync(&point);
+            sync.arriveAndWait();
+            released[i] = SyncPoint::Clock::now();
+            sync.complete("monitor" + std::to_string(i));
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (auto at : released) {
+        CHECK(at - start >= 60ms);
+        CHECK(at - released[0] < 20ms && released[0] - at < 20ms);
+    }
+
+    auto times = point.completionTimes();
+    CHECK(times.size() == participants);
+    for (auto const& [ id, ms ] : times) {
+        CHECK(ms >= 0 && ms < 20);
+    }
+    CHECK(point.spread() < 20);
+}
+
+void
+droppedParticipantsDoNotBlock()
+{
+    SyncPoint point(3);
+    std::vector<std::thread> threads;
+
+    // Returns early, like a monitor whose value is already set
+    threads.emplace_back([&] { SyncParticipant sync(&point); });
+
+    for (int i = 0; i < 2; i++) {
+        threads.emplace_back([&, i] {
+            SyncParticipant sync(&point);
+            sync.arriveAndWait();
+            sync.complete(std::to_string(i));
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    CHECK(point.completionTimes().size() == 2);
+}
+
+void
+doesNothingWithoutPoint()
+{
+    SyncParticipant sync(nullptr);
+    CHECK(!sync);
+
+    sync.arriveAndWait();
+    sync.complete("monitor");
+}
+
+} // namespace
+
+
+int
+main()
+{
+    releasesTogether();
+    droppedParticipantsDoNotBlock();
+    doesNothingWithoutPoint();
+
+    return EXIT_SUCCESS;
+}
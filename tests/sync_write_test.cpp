@@ -0,0 +1,111 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <string>
+
+#include "check.h"
+
+namespace fs = std::filesystem;
+
+
+namespace {
+
+constexpr int monitors = 4;
+
+/**
+ * Runs ddccli with --sync against monitors whose transactions take 40ms
+ * longer on each successive one, and returns when the write of `code`
+ * reached each monitor, in steady clock nanoseconds by monitor index.
+ */
+std::map<int, int64_t>
+syncedWrites(const std::string& ddccli, const std::string& arguments, int code)
+{
+    auto log = fs::temp_directory_path() / "ddccli-sync-writes.log";
+    fs::remove(log);
+
+    setenv("FAKE_WRITE_LOG", log.c_str(), 1);
+    auto command = "\"" + ddccli + "\" --sync -j " + arguments + " > "
+                   + (fs::temp_directory_path() / "ddccli-sync.json").string();
+    CHECK(std::system(command.c_str()) == 0);
+
+    std::map<int, int64_t> writes;
+    std::ifstream lines(log);
+    int monitor, writtenCode;
+    unsigned long value;
+    int64_t appliedAt;
+    while (lines >> monitor >> writtenCode >> value >> appliedAt) {
+        if (writtenCode == code) {
+            CHECK(writes.count(monitor) == 0);
+            writes[monitor] = appliedAt;
+        }
+    }
+
+    return writes;
+}
+
+// Every write, including the read of the maximum that precedes it, must be
+// prepared before the barrier, so only the release separates them
+void
+writesLandTogether(const std::string& ddccli,
+                   const std::string& arguments,
+                   int code)
+{
+    auto writes = syncedWrites(ddccli, arguments, code);
+    CHECK(writes.size() == monitors);
+
+    auto [ first, last ] = std::minmax_element(
+      writes.begin(), writes.end(), [](const auto& a, const auto& b) {
+          return a.second < b.second;
+      });
+
+    // Reading after the release would spread them by the 40ms latency step
+    // per monitor
+    CHECK(last->second - first->second < 20'000'000);
+}
+
+} // namespace
+
+
+int
+main(int argc, char* argv[])
+{
+    CHECK(argc == 2);
+    std::string ddccli = argv[1];
+
+    setenv("FAKE_MONITORS", std::to_string(monitors).c_str(), 1);
+    setenv("FAKE_LATENCY_MS", "10", 1);
+    setenv("FAKE_LATENCY_STEP_MS", "40", 1);
+
+    writesLandTogether(ddccli, "-b 40", 0x10);
+    writesLandTogether(ddccli, "-c 30", 0x12);
+    writesLandTogether(ddccli, "--set-vcp volume=20", 0x62);
+
+    return EXIT_SUCCESS;
+}
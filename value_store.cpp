@@ -0,0 +1,165 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "value_store.h"
+
+#include "state.h"
+
+using json = nlohmann::json;
+
+
+namespace {
+
+std::filesystem::path
+getStorePath()
+{
+    return getStateDirectory() / "values.json";
+}
+
+json
+readEntries()
+{
+    auto contents = readStateFile(getStorePath());
+    if (!contents) {
+        return json::object();
+    }
+
+    try {
+        auto entries = json::parse(*contents);
+        if (entries.is_object()) {
+            return entries;
+        }
+    } catch (const std::exception&) {
+        // Corrupt store, start over
+    }
+
+    return json::object();
+}
+
+int64_t
+now()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+std::string
+codeKey(uint8_t code)
+{
+    static const char digits[] = "0123456789ABCDEF";
+    return { digits[code >> 4], digits[code & 0xf] };
+}
+
+} // namespace
+
+
+ValueStore::ValueStore() : entries(readEntries()) {}
+
+std::optional<VcpFeature>
+ValueStore::get(const std::string& deviceId,
+                uint8_t code,
+                std::chrono::milliseconds maxAge) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto monitor = entries.find(hashDeviceId(deviceId));
+    if (monitor == entries.end() || !monitor->is_object()) {
+        return std::nullopt;
+    }
+
+    auto entry = monitor->find(codeKey(code));
+    if (entry == monitor->end() || !entry->is_object()) {
+        return std::nullopt;
+    }
+
+    try {
+        auto age = now() - entry->at("time").get<int64_t>();
+        if (age < 0 || age > maxAge.count()) {
+            return std::nullopt;
+        }
+
+        return VcpFeature{ entry->at("maximum").get<unsigned long>(),
+                           entry->at("value").get<unsigned long>() };
+    } catch (const std::exception&) {
+        return std::nullopt;
+    }
+}
+
+void
+ValueStore::put(const std::string& deviceId, uint8_t code, VcpFeature value)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto& entry = entries[hashDeviceId(deviceId)][codeKey(code)];
+
+    auto maximum = value.maximumValue;
+    if (maximum == 0 && entry.is_object() && entry.count("maximum")) {
+        maximum = entry["maximum"].get<unsigned long>();
+    }
+
+    entry = { { "value", value.currentValue },
+              { "maximum", maximum },
+              { "time", now() } };
+    dirty = true;
+}
+
+void
+ValueStore::save()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (!dirty) {
+        return;
+    }
+
+    // Held until the merged file is in place, or another process could
+    // merge against the file this one is about to replace
+    ScopedStateLock fileLock(getStorePath());
+
+    auto merged = readEntries();
+    for (auto monitor = entries.begin(); monitor != entries.end(); ++monitor) {
+        if (!monitor->is_object()) {
+            continue;
+        }
+
+        auto& mergedCodes = merged[monitor.key()];
+        if (!mergedCodes.is_object()) {
+            mergedCodes = json::object();
+        }
+
+        for (auto entry = monitor->begin(); entry != monitor->end(); ++entry) {
+            auto existing = mergedCodes.find(entry.key());
+            if (existing == mergedCodes.end()
+                || existing->value("time", int64_t(0))
+                     <= entry->value("time", int64_t(0))) {
+                mergedCodes[entry.key()] = *entry;
+            }
+        }
+    }
+
+    writeStateFile(getStorePath(), merged.dump());
+    entries = std::move(merged);
+    dirty = false;
+}
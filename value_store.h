@@ -0,0 +1,73 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+
+#include <json.hpp>
+
+#include "monitor.h"
+
+
+/**
+ * Last-known VCP values, persisted in a small file in the state directory so
+ * separate invocations can serve reads without touching the bus when a
+ * recent enough value exists. Keyed by DeviceID hash and VCP code.
+ *
+ * Safe to use from executor threads.
+ */
+class ValueStore {
+public:
+    // Loads the store from disk
+    ValueStore();
+
+    /**
+     * Returns the stored value if it was recorded within `maxAge`.
+     */
+    std::optional<VcpFeature> get(const std::string& deviceId,
+                                  uint8_t code,
+                                  std::chrono::milliseconds maxAge) const;
+
+    /**
+     * Records a value read from or written to the monitor. A zero maximum
+     * (unknown, as after a write) keeps the previously stored maximum.
+     */
+    void put(const std::string& deviceId, uint8_t code, VcpFeature value);
+
+    /**
+     * Writes changes back, merged with whatever other processes have stored
+     * since this one loaded (newest entry wins).
+     */
+    void save();
+
+private:
+    mutable std::mutex mutex;
+    nlohmann::json entries;
+    bool dirty = false;
+};
@@ -0,0 +1,298 @@
+/*
+
+Copyright (c) 2018 Matt Hensman <m@matt.tf>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+
+/**
+ * MCCS VCP code metadata. Everything here is constexpr: adding a feature is
+ * a table entry, and name lookup uses a perfect hash computed at compile
+ * time, so nothing is built at startup.
+ */
+
+enum class VcpType : uint8_t { Continuous, NonContinuous, Table };
+
+enum class VcpAccess : uint8_t { ReadOnly, WriteOnly, ReadWrite };
+
+struct VcpValueName {
+    uint16_t value;
+    std::string_view name;
+};
+
+struct VcpCode {
+    uint8_t code;
+    std::string_view name;
+    VcpType type;
+    VcpAccess access;
+
+    const VcpValueName* values = nullptr;
+    size_t valueCount = 0;
+
+    constexpr bool isReadable() const { return access != VcpAccess::WriteOnly; }
+    constexpr bool isWritable() const { return access != VcpAccess::ReadOnly; }
+
+    /**
+     * A stored setting: written by value and read back the same, so it can
+     * be saved and reapplied. Excludes resets (write-only) and the few
+     * readable codes where writing performs an action instead.
+     */
+    constexpr bool isSetting() const
+    {
+        constexpr uint8_t actionCodes[] = {
+            0x02, // new-control-value
+            0x1e, // auto-setup
+            0xd6, // power
+        };
+
+        for (auto action : actionCodes) {
+            if (code == action) {
+                return false;
+            }
+        }
+
+        return access == VcpAccess::ReadWrite;
+    }
+};
+
+
+namespace vcp {
+
+inline constexpr VcpValueName colorPresetValues[] = {
+    { 0x01, "srgb" },  { 0x02, "native" },  { 0x03, "4000k" },
+    { 0x04, "5000k" }, { 0x05, "6500k" },   { 0x06, "7500k" },
+    { 0x07, "8200k" }, { 0x08, "9300k" },   { 0x09, "10000k" },
+    { 0x0a, "11500k" }, { 0x0b, "user1" }, { 0x0c, "user2" },
+    { 0x0d, "user3" }
+};
+
+inline constexpr VcpValueName inputSourceValues[] = {
+    { 0x01, "vga1" },       { 0x02, "vga2" },       { 0x03, "dvi1" },
+    { 0x04, "dvi2" },       { 0x05, "composite1" }, { 0x06, "composite2" },
+    { 0x07, "svideo1" },    { 0x08, "svideo2" },    { 0x09, "tuner1" },
+    { 0x0a, "tuner2" },     { 0x0b, "tuner3" },     { 0x0c, "component1" },
+    { 0x0d, "component2" }, { 0x0e, "component3" }, { 0x0f, "dp1" },
+    { 0x10, "dp2" },        { 0x11, "hdmi1" },      { 0x12, "hdmi2" }
+};
+
+inline constexpr VcpValueName audioMuteValues[] = { { 0x01, "on" },
+                                                    { 0x02, "off" } };
+
+inline constexpr VcpValueName osdValues[] = { { 0x01, "disabled" },
+                                              { 0x02, "enabled" } };
+
+inline constexpr VcpValueName powerModeValues[] = { { 0x01, "on" },
+                                                    { 0x02, "standby" },
+                                                    { 0x03, "suspend" },
+                                                    { 0x04, "off" },
+                                                    { 0x05, "hard-off" } };
+
+inline constexpr VcpValueName displayTechnologyValues[] = {
+    { 0x01, "crt-shadow-mask" }, { 0x02, "crt-aperture-grill" },
+    { 0x03, "lcd" },             { 0x04, "lcos" },
+    { 0x05, "plasma" },          { 0x06, "oled" },
+    { 0x07, "el" },              { 0x08, "mem" }
+};
+
+template<size_t N>
+constexpr VcpCode
+withValues(VcpCode code, const VcpValueName (&values)[N])
+{
+    code.values = values;
+    code.valueCount = N;
+    return code;
+}
+
+inline constexpr auto codes = [] {
+    using T = VcpType;
+    using A = VcpAccess;
+
+    return std::to_array<VcpCode>({
+        { 0x02, "new-control-value", T::NonContinuous, A::ReadWrite },
+        { 0x04, "factory-reset", T::NonContinuous, A::WriteOnly },
+        { 0x05, "reset-brightness-contrast", T::NonContinuous, A::WriteOnly },
+        { 0x06, "reset-geometry", T::NonContinuous, A::WriteOnly },
+        { 0x08, "reset-color", T::NonContinuous, A::WriteOnly },
+        { 0x0b, "color-temperature-increment", T::Continuous, A::ReadOnly },
+        { 0x0c, "color-temperature", T::Continuous, A::ReadWrite },
+        { 0x10, "brightness", T::Continuous, A::ReadWrite },
+        { 0x12, "contrast", T::Continuous, A::ReadWrite },
+        withValues({ 0x14, "color-preset", T::NonContinuous, A::ReadWrite },
+                   colorPresetValues),
+        { 0x16, "red-gain", T::Continuous, A::ReadWrite },
+        { 0x18, "green-gain", T::Continuous, A::ReadWrite },
+        { 0x1a, "blue-gain", T::Continuous, A::ReadWrite },
+        { 0x1e, "auto-setup", T::NonContinuous, A::ReadWrite },
+        { 0x52, "active-control", T::NonContinuous, A::ReadOnly },
+        withValues({ 0x60, "input", T::NonContinuous, A::ReadWrite },
+                   inputSourceValues),
+        { 0x62, "volume", T::Continuous, A::ReadWrite },
+        { 0x6c, "red-black-level", T::Continuous, A::ReadWrite },
+        { 0x6e, "green-black-level", T::Continuous, A::ReadWrite },
+        { 0x70, "blue-black-level", T::Continuous, A::ReadWrite },
+        { 0x73, "lut-size", T::Table, A::ReadOnly },
+        { 0x74, "single-point-lut", T::Table, A::ReadWrite },
+        { 0x75, "block-lut", T::Table, A::ReadWrite },
+        { 0x86, "scaling", T::NonContinuous, A::ReadWrite },
+        { 0x87, "sharpness", T::Continuous, A::ReadWrite },
+        withValues({ 0x8d, "mute", T::NonContinuous, A::ReadWrite },
+                   audioMuteValues),
+        { 0xaa, "orientation", T::NonContinuous, A::ReadOnly },
+        { 0xac, "horizontal-frequency", T::Continuous, A::ReadOnly },
+        { 0xae, "vertical-frequency", T::Continuous, A::ReadOnly },
+        { 0xb2, "subpixel-layout", T::NonContinuous, A::ReadOnly },
+        withValues({ 0xb6, "technology", T::NonContinuous, A::ReadOnly },
+                   displayTechnologyValues),
+        { 0xc0, "usage-time", T::Continuous, A::ReadOnly },
+        { 0xc6, "application-key", T::NonContinuous, A::ReadOnly },
+        { 0xc8, "controller-type", T::NonContinuous, A::ReadOnly },
+        { 0xc9, "firmware-level", T::Continuous, A::ReadOnly },
+        withValues({ 0xca, "osd", T::NonContinuous, A::ReadWrite }, osdValues),
+        { 0xcc, "osd-language", T::NonContinuous, A::ReadWrite },
+        withValues({ 0xd6, "power", T::NonContinuous, A::ReadWrite },
+                   powerModeValues),
+        { 0xdc, "display-mode", T::NonContinuous, A::ReadWrite },
+        { 0xdf, "vcp-version", T::NonContinuous, A::ReadOnly },
+    });
+}();
+
+inline constexpr size_t codeCount = codes.size();
+static_assert(codeCount < UINT8_MAX, "code index must fit in a byte");
+
+
+constexpr uint32_t
+hashName(std::string_view name, uint32_t seed)
+{
+    // FNV-1a, seeded
+    uint32_t hash = 2166136261u ^ seed;
+    for (char c : name) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+inline constexpr size_t nameSlotCount = 512;
+
+/**
+ * Finds a seed for which every name hashes to a distinct slot.
+ */
+constexpr uint32_t
+findPerfectSeed()
+{
+    for (uint32_t seed = 0; seed < 1024; seed++) {
+        bool taken[nameSlotCount] = {};
+        bool collision = false;
+
+        for (size_t i = 0; i < codeCount && !collision; i++) {
+            auto slot = hashName(codes[i].name, seed) % nameSlotCount;
+            collision = taken[slot];
+            taken[slot] = true;
+        }
+
+        if (!collision) {
+            return seed;
+        }
+    }
+
+    return UINT32_MAX;
+}
+
+inline constexpr uint32_t nameSeed = findPerfectSeed();
+static_assert(nameSeed != UINT32_MAX, "no perfect hash seed for VCP names");
+
+// Slot -> index into codes + 1, 0 if empty
+inline constexpr auto nameSlots = [] {
+    std::array<uint8_t, nameSlotCount> slots{};
+    for (size_t i = 0; i < codeCount; i++) {
+        slots[hashName(codes[i].name, nameSeed) % nameSlotCount] =
+          static_cast<uint8_t>(i + 1);
+    }
+    return slots;
+}();
+
+// Code -> index into codes + 1, 0 if unknown
+inline constexpr auto codeSlots = [] {
+    std::array<uint8_t, 256> slots{};
+    for (size_t i = 0; i < codeCount; i++) {
+        slots[codes[i].code] = static_cast<uint8_t>(i + 1);
+    }
+    return slots;
+}();
+
+} // namespace vcp
+
+
+constexpr const VcpCode*
+findVcpCode(std::string_view name)
+{
+    auto slot = vcp::nameSlots[vcp::hashName(name, vcp::nameSeed)
+                               % vcp::nameSlotCount];
+
+    if (slot == 0 || vcp::codes[slot - 1].name != name) {
+        return nullptr;
+    }
+
+    return &vcp::codes[slot - 1];
+}
+
+constexpr const VcpCode*
+findVcpCode(uint8_t code)
+{
+    auto slot = vcp::codeSlots[code];
+    return slot == 0 ? nullptr : &vcp::codes[slot - 1];
+}
+
+constexpr const VcpValueName*
+findVcpValue(const VcpCode& code, std::string_view name)
+{
+    for (size_t i = 0; i < code.valueCount; i++) {
+        if (code.values[i].name == name) {
+            return &code.values[i];
+        }
+    }
+
+    return nullptr;
+}
+
+constexpr const VcpValueName*
+findVcpValue(const VcpCode& code, uint16_t value)
+{
+    for (size_t i = 0; i < code.valueCount; i++) {
+        if (code.values[i].value == value) {
+            return &code.values[i];
+        }
+    }
+
+    return nullptr;
+}
+
+static_assert(findVcpCode("brightness")->code == 0x10);
+static_assert(findVcpCode("contrast")->code == 0x12);
+static_assert(findVcpCode(0x60)->name == "input");